@@ -12,12 +12,23 @@ int main(int argc, char* argv[])
 {
     if (argc != 2) return -1;
     int runs = atoi(argv[1]);
+
+    Rules rules;
+    try
+    {
+        rules = Rules::fromFile("rules.txt");
+    }
+    catch (const RulesError& e)
+    {
+        cerr << e.what() << endl;
+        return -2;
+    }
     
-    auto oneRun = [](int i)
+    auto oneRun = [&rules](int i)
     {
         try
         {
-            CustomCore core(1, i);
+            CustomCore core(1, i, rules);
             core.go();
         }
         catch (GameOver& go)
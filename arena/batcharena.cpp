@@ -0,0 +1,174 @@
+#include "batchcore.hpp"
+#include "galosengen.hpp"
+
+#include "../inugami/metrics.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <cstdlib>
+#include <ctime>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) return -1;
+    int runs  = atoi(argv[1]);
+    int lanes = (argc >= 3 && argv[2][0] != '-')? atoi(argv[2]) : 64;
+
+    //--metrics FILE rewrites FILE every second, --metrics-socket PATH serves
+    string metricsFile;
+    string metricsSocket;
+    for (int i=2; i+1<argc; ++i)
+    {
+        string arg = argv[i];
+        if (arg == "--metrics") metricsFile = argv[i+1];
+        if (arg == "--metrics-socket") metricsSocket = argv[i+1];
+    }
+
+    if (runs < 1 || lanes < 1) return -2;
+    if (lanes > runs) lanes = runs;
+    if (lanes > BatchCore::MAX_LANES) lanes = BatchCore::MAX_LANES;
+
+    Rules rules;
+    try
+    {
+        rules = Rules::fromFile("rules.txt");
+    }
+    catch (const RulesError& e)
+    {
+        cerr << e.what() << endl;
+        return -3;
+    }
+
+    Inugami::Metrics metrics;
+    auto& games    = metrics.counter("arena_games_total", "Games finished.");
+    auto& played   = metrics.counter("arena_moves_total", "Moves picked by the AI.");
+    auto& evals    = metrics.counter("arena_evaluations_total", "Boards evaluated by the AI.");
+    auto& gameRate = metrics.gauge("arena_games_per_second", "Games finished per second, over the last second.");
+    auto& evalRate = metrics.gauge("arena_evaluations_per_second", "Boards evaluated per second, over the last second.");
+
+    try
+    {
+        if (!metricsSocket.empty()) metrics.serve(metricsSocket);
+    }
+    catch (const Inugami::MetricsException& e)
+    {
+        cerr << e.what() << endl;
+        return -4;
+    }
+
+    auto window = chrono::steady_clock::now();
+    uint64_t windowGames = 0;
+    uint64_t windowEvals = 0;
+
+    auto report = [&]
+    {
+        double secs = chrono::duration<double>(chrono::steady_clock::now() - window).count();
+        gameRate.set((games.get()-windowGames)/secs);
+        evalRate.set((evals.get()-windowEvals)/secs);
+
+        window = chrono::steady_clock::now();
+        windowGames = games.get();
+        windowEvals = evals.get();
+
+        if (metricsFile.empty()) return;
+
+        try
+        {
+            metrics.writeFile(metricsFile);
+        }
+        catch (const Inugami::MetricsException& e)
+        {
+            cerr << e.what() << endl;
+        }
+    };
+
+    BatchCore batch(rules, lanes, time(nullptr));
+
+    const string conv = string(".pbygrcv").substr(0, rules.numColors+1);
+    GaloSengen gs(rules, conv.substr(1));
+
+    vector<BatchCore::Move> moves(lanes);
+    vector<string> bored(batch.height(), string(batch.width(), '.'));
+
+    int started = lanes;
+    int done = 0;
+    int tote = 0;
+    int high = 0;
+
+    while (done < runs)
+    {
+        const BatchCore::Mask live = batch.live();
+
+        for (int l=0; l<lanes; ++l)
+        {
+            moves[l] = {BatchCore::Move::NONE, 0, 0};
+            if (!(live>>l & 1)) continue;
+
+            for (int r=0; r<batch.height(); ++r)
+            {
+                for (int c=0; c<batch.width(); ++c)
+                {
+                    bored[r][c] = conv[batch.cellAt(l, r, c)];
+                }
+            }
+
+            stringstream ss(gs.play(bored)->str());
+            played.add();
+
+            string action;
+            ss >> action;
+
+            if (action == "SWAP")
+            {
+                int r1, c1, r2, c2;
+                ss >> r1 >> c1 >> r2 >> c2;
+                moves[l] = {BatchCore::Move::SWAP, uint16_t(r1*batch.width()+c1), uint16_t(r2*batch.width()+c2)};
+            }
+            else if (action == "SCORE")
+            {
+                int r1, c1;
+                ss >> r1 >> c1;
+                moves[l] = {BatchCore::Move::SCORE, uint16_t(r1*batch.width()+c1), 0};
+            }
+        }
+
+        stepAll(batch, moves);
+
+        evals.add(gs.evaluations - evals.get());
+
+        const BatchCore::Mask over = batch.over();
+        BatchCore::Mask again = 0;
+
+        for (int l=0; l<lanes; ++l)
+        {
+            if (!(over>>l & 1) || !(live>>l & 1)) continue;
+
+            int scr = batch.scoreOf(l);
+            tote += scr;
+            if (scr>high) high = scr;
+            ++done;
+            games.add();
+
+            if (started < runs)
+            {
+                again |= BatchCore::Mask(1)<<l;
+                ++started;
+            }
+        }
+
+        batch.reset(again);
+
+        if (chrono::steady_clock::now() - window >= chrono::seconds(1)) report();
+    }
+
+    report();
+
+    double avg = double(tote)/double(runs);
+
+    cout << avg << " " << high << endl;
+}
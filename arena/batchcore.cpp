@@ -0,0 +1,357 @@
+/*******************************************************************************
+ * Inugami - An OpenGL framework designed for rapid game development
+ * Version: 0.2.0
+ * https://github.com/DBRalir/Inugami
+ *
+ * Copyright (c) 2012 Jeramy Harrison <dbralir@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#include "batchcore.hpp"
+
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+
+static inline std::uint32_t xorshift(std::uint32_t& s)
+{
+    s ^= s << 13;
+    s ^= s >> 17;
+    s ^= s << 5;
+    return s;
+}
+
+static inline std::uint32_t below(std::uint32_t& s, std::uint32_t n)
+{
+    return (std::uint64_t(xorshift(s)) * n) >> 32;
+}
+
+BatchCore::BatchCore(const Rules& r, int n, std::uint32_t seed)
+    : rules(r)
+
+    , lanes(n)
+    , cells(rules.width*rules.height)
+
+    , board(cells*lanes, 0)
+    , zone(cells, 0)
+    , score(lanes, 0)
+    , rng(lanes)
+
+    , gameOver(0)
+
+    , moveA(lanes)
+    , moveB(lanes)
+    , target(lanes)
+    , group(cells*lanes)
+    , zeros(lanes, 0)
+{
+    if (lanes < 1 || lanes > MAX_LANES) throw std::out_of_range("Bad lane count!");
+
+    for (int r=0; r<rules.height; ++r)
+    {
+        for (int c=0; c<rules.width; ++c) zone[r*rules.width+c] = rules.isScoreTile(r, c);
+    }
+
+    std::mt19937 seeder(seed);
+    for (std::uint32_t& s : rng)
+    {
+        do s = seeder(); while (s == 0);
+    }
+
+    spawn(rules.swapSpawn, allLanes());
+}
+
+int BatchCore::numLanes() const
+{
+    return lanes;
+}
+
+int BatchCore::width() const
+{
+    return rules.width;
+}
+
+int BatchCore::height() const
+{
+    return rules.height;
+}
+
+int BatchCore::minScore() const
+{
+    return rules.minScore;
+}
+
+BatchCore::Cell BatchCore::cellAt(int lane, int r, int c) const
+{
+    return board[(r*rules.width+c)*lanes+lane];
+}
+
+int BatchCore::scoreOf(int lane) const
+{
+    return score[lane];
+}
+
+bool BatchCore::isScoreTile(int r, int c) const
+{
+    return zone[r*rules.width+c];
+}
+
+BatchCore::Mask BatchCore::over() const
+{
+    return gameOver;
+}
+
+BatchCore::Mask BatchCore::live() const
+{
+    return allLanes() & ~gameOver;
+}
+
+void BatchCore::reset(Mask m)
+{
+    m &= allLanes();
+
+    for (int i=0; i<cells; ++i)
+    {
+        Cell* row = &board[i*lanes];
+        for (int l=0; l<lanes; ++l) if (m>>l & 1) row[l] = 0;
+    }
+
+    for (int l=0; l<lanes; ++l) if (m>>l & 1) score[l] = 0;
+
+    gameOver &= ~m;
+
+    spawn(rules.swapSpawn, m);
+}
+
+BatchCore::Mask BatchCore::allLanes() const
+{
+    return (lanes == 64)? ~Mask(0) : (Mask(1)<<lanes)-1;
+}
+
+void BatchCore::spawn(int n, Mask m)
+{
+    std::uint32_t empty[MAX_LANES] = {};
+
+    for (int i=0; i<cells; ++i)
+    {
+        const Cell* row = &board[i*lanes];
+        for (int l=0; l<lanes; ++l) empty[l] += (row[l] == 0);
+    }
+
+    for (int l=0; l<lanes; ++l)
+    {
+        if ((m>>l & 1) && empty[l] < std::uint32_t(n)) gameOver |= Mask(1)<<l;
+    }
+
+    m &= ~gameOver;
+    if (!m) return;
+
+    std::uint32_t pick[MAX_LANES];
+    std::uint32_t seen[MAX_LANES];
+    Cell color[MAX_LANES];
+
+    for (int k=0; k<n; ++k)
+    {
+        for (int l=0; l<lanes; ++l)
+        {
+            const bool on = m>>l & 1;
+            pick[l]  = on? below(rng[l], empty[l]-k) : 0xFFFFFFFF;
+            color[l] = on? 1+below(rng[l], rules.numColors) : 0;
+            seen[l]  = 0;
+        }
+
+        // Every lane walks its empties in the same order; the one whose count
+        // matches the draw takes the new piece.
+        for (int i=0; i<cells; ++i)
+        {
+            Cell* row = &board[i*lanes];
+            for (int l=0; l<lanes; ++l)
+            {
+                const std::uint32_t e = (row[l] == 0);
+                row[l] = (e && seen[l] == pick[l])? color[l] : row[l];
+                seen[l] += e;
+            }
+        }
+    }
+}
+
+void BatchCore::swapCells(Mask m)
+{
+    for (int l=0; l<lanes; ++l)
+    {
+        if (!(m>>l & 1)) continue;
+
+        Cell& cell1 = board[moveA[l]*lanes+l];
+        Cell& cell2 = board[moveB[l]*lanes+l];
+
+        if (cell1 == 0 || cell2 == 0)
+        {
+            m &= ~(Mask(1)<<l);
+            continue;
+        }
+
+        std::swap(cell1, cell2);
+    }
+
+    spawn(rules.swapSpawn, m);
+}
+
+void BatchCore::scoreCells(Mask m)
+{
+    const int w = rules.width;
+
+    std::fill(begin(group), end(group), 0);
+
+    for (int l=0; l<lanes; ++l)
+    {
+        target[l] = 0xFF;
+        if (!(m>>l & 1)) continue;
+
+        Cell k = board[moveA[l]*lanes+l];
+        if (k == 0)
+        {
+            m &= ~(Mask(1)<<l);
+            continue;
+        }
+
+        target[l] = k;
+        group[moveA[l]*lanes+l] = 1;
+    }
+
+    if (!m) return;
+
+    // Flood fill by repeated dilation, alternating sweep direction so chains
+    // running either way converge in a few passes.
+    auto sweep = [&](int i)
+    {
+        const int r = i/w;
+        const int c = i%w;
+
+        const Cell* b  = &board[i*lanes];
+        Cell*       g  = &group[i*lanes];
+        const Cell* up = (r>0)?              &group[(i-w)*lanes] : zeros.data();
+        const Cell* dn = (r<rules.height-1)? &group[(i+w)*lanes] : zeros.data();
+        const Cell* lf = (c>0)?              &group[(i-1)*lanes] : zeros.data();
+        const Cell* rt = (c<w-1)?            &group[(i+1)*lanes] : zeros.data();
+
+        Cell grew = 0;
+        for (int l=0; l<lanes; ++l)
+        {
+            const Cell n = up[l] | dn[l] | lf[l] | rt[l];
+            const Cell grow = n & (b[l] == target[l]) & (g[l] ^ 1);
+            g[l] |= grow;
+            grew |= grow;
+        }
+        return grew;
+    };
+
+    Cell grew = 1;
+    while (grew)
+    {
+        grew = 0;
+        for (int i=0; i<cells; ++i)    grew |= sweep(i);
+        for (int i=cells-1; i>=0; --i) grew |= sweep(i);
+    }
+
+    std::uint32_t size[MAX_LANES] = {};
+    Cell touch[MAX_LANES] = {};
+
+    for (int i=0; i<cells; ++i)
+    {
+        const Cell* g = &group[i*lanes];
+        const Cell z = zone[i];
+        for (int l=0; l<lanes; ++l)
+        {
+            size[l]  += g[l];
+            touch[l] |= g[l] & z;
+        }
+    }
+
+    Cell valid[MAX_LANES];
+
+    for (int l=0; l<lanes; ++l)
+    {
+        valid[l] = (m>>l & 1) && touch[l] && size[l] >= std::uint32_t(rules.minScore);
+        if (!valid[l])
+        {
+            m &= ~(Mask(1)<<l);
+            continue;
+        }
+        score[l] += (target[l]+1) * size[l];
+    }
+
+    for (int i=0; i<cells; ++i)
+    {
+        Cell* row = &board[i*lanes];
+        const Cell* g = &group[i*lanes];
+        for (int l=0; l<lanes; ++l)
+        {
+            row[l] = (g[l] & valid[l])? 0 : row[l];
+        }
+    }
+
+    spawn(rules.scoreSpawn, m);
+}
+
+void stepAll(BatchCore& batch, const std::vector<BatchCore::Move>& moves)
+{
+    using Mask = BatchCore::Mask;
+    using Move = BatchCore::Move;
+
+    if (int(moves.size()) != batch.lanes) throw std::invalid_argument("One move per lane!");
+
+    Mask swaps  = 0;
+    Mask scores = 0;
+
+    const Mask live = batch.live();
+
+    for (int l=0; l<batch.lanes; ++l)
+    {
+        const Move& mv = moves[l];
+
+        if (!(live>>l & 1)) continue;
+        if (mv.a >= batch.cells || mv.b >= batch.cells) continue;
+
+        batch.moveA[l] = mv.a;
+        batch.moveB[l] = mv.b;
+
+        switch (mv.kind)
+        {
+            case Move::SWAP:
+            {
+                swaps |= Mask(1)<<l;
+            break;}
+
+            case Move::SCORE:
+            {
+                scores |= Mask(1)<<l;
+            break;}
+
+            case Move::NONE:
+            default:
+            {
+            break;}
+        }
+    }
+
+    batch.swapCells(swaps);
+    batch.scoreCells(scores);
+}
@@ -0,0 +1,108 @@
+/*******************************************************************************
+ * Inugami - An OpenGL framework designed for rapid game development
+ * Version: 0.2.0
+ * https://github.com/DBRalir/Inugami
+ *
+ * Copyright (c) 2012 Jeramy Harrison <dbralir@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#ifndef BATCHCORE_H
+#define BATCHCORE_H
+
+#include "../rules.hpp"
+
+#include <cstdint>
+#include <vector>
+
+// Runs many games in lockstep. Boards are packed cell-major, so the lanes of
+// one cell sit next to each other and every rule is a loop over contiguous
+// lanes that the compiler can vectorize.
+class BatchCore
+{
+public:
+    using Cell = std::uint8_t;
+    using Mask = std::uint64_t;
+
+    static constexpr int MAX_LANES = 64;
+
+    class Move
+    {
+    public:
+        enum Kind : std::uint8_t
+        {
+              NONE
+            , SWAP
+            , SCORE
+        };
+
+        Kind kind;
+        std::uint16_t a;
+        std::uint16_t b;
+    };
+
+    BatchCore(const Rules& rules, int lanes, std::uint32_t seed);
+
+    int numLanes() const;
+    int width() const;
+    int height() const;
+    int minScore() const;
+
+    Cell cellAt(int lane, int r, int c) const;
+    int scoreOf(int lane) const;
+    bool isScoreTile(int r, int c) const;
+
+    Mask over() const;
+    Mask live() const;
+
+    void reset(Mask lanes);
+
+    friend void stepAll(BatchCore& batch, const std::vector<Move>& moves);
+
+private:
+    Rules rules;
+
+    int lanes;
+    int cells;
+
+    std::vector<Cell> board;
+    std::vector<Cell> zone;
+    std::vector<std::int32_t> score;
+    std::vector<std::uint32_t> rng;
+
+    Mask gameOver;
+
+    std::vector<std::uint16_t> moveA;
+    std::vector<std::uint16_t> moveB;
+    std::vector<Cell> target;
+    std::vector<Cell> group;
+    std::vector<Cell> zeros;
+
+    Mask allLanes() const;
+
+    void spawn(int n, Mask lanes);
+    void swapCells(Mask lanes);
+    void scoreCells(Mask lanes);
+};
+
+void stepAll(BatchCore& batch, const std::vector<BatchCore::Move>& moves);
+
+#endif // BATCHCORE_H
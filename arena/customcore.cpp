@@ -55,8 +55,8 @@ bool CustomCore::Loc::operator!=(const Loc& in) const
     return (std::tie(r, c) != std::tie(in.r, in.c));
 }
 
-CustomCore::CustomCore(int i, int j)
-    : rules{5, 5, 3, 10, 8, 5}
+CustomCore::CustomCore(int i, int j, const Rules& r)
+    : rules(r)
 
     , board(rules.width*rules.height, Color::NONE)
 
@@ -72,10 +72,12 @@ CustomCore::CustomCore(int i, int j)
     , scoreZone()
 {
 #if 1
-    for (int r=2; r<rules.height-2; ++r)
+    for (int r=0; r<rules.height; ++r)
     {
-        for (int c=0; c<2; ++c) scoreZone.insert({r, c});
-        for (int c=rules.width-2; c<rules.width; ++c) scoreZone.insert({r, c});
+        for (int c=0; c<rules.width; ++c)
+        {
+            if (rules.isScoreTile(r, c)) scoreZone.insert({r, c});
+        }
     }
 #else
     {
@@ -113,7 +115,7 @@ void CustomCore::swapCells(const Loc& a, const Loc& b, bool force)
 
     std::swap(cell1, cell2);
 
-    return spawn(5);
+    return spawn(rules.swapSpawn);
 }
 
 void CustomCore::scoreCell(const Loc& loc)
@@ -130,25 +132,38 @@ void CustomCore::scoreCell(const Loc& loc)
     
     for (const Loc& l : group) cellAt(l) = Color::NONE;
 
-    return spawn(3);
+    return spawn(rules.scoreSpawn);
 }
 
 bool CustomCore::getGroup(const Loc& loc, Color k, std::set<Loc>& s)
 {
-    Color& cell = cellAt(loc);
-    if (cell != k) return false;
+    if (cellAt(loc) != k) return false;
 
-    if (!s.insert(loc).second) return false;
-
-    bool isScoring = isScoreTile(loc);
+    bool isScoring = false;
 
     int a = rules.height-1;
     int b = rules.width-1;
 
-    if (loc.r>0) isScoring += getGroup({loc.r-1, loc.c}, k, s);
-    if (loc.r<a) isScoring += getGroup({loc.r+1, loc.c}, k, s);
-    if (loc.c>0) isScoring += getGroup({loc.r, loc.c-1}, k, s);
-    if (loc.c<b) isScoring += getGroup({loc.r, loc.c+1}, k, s);
+    std::vector<Loc> open {loc};
+    s.insert(loc);
+
+    while (!open.empty())
+    {
+        Loc l = open.back();
+        open.pop_back();
+
+        isScoring |= isScoreTile(l);
+
+        auto visit = [&](Loc n)
+        {
+            if (cellAt(n) == k && s.insert(n).second) open.push_back(n);
+        };
+
+        if (l.r>0) visit({l.r-1, l.c});
+        if (l.r<a) visit({l.r+1, l.c});
+        if (l.c>0) visit({l.r, l.c-1});
+        if (l.c<b) visit({l.r, l.c+1});
+    }
 
     return isScoring;
 }
@@ -176,7 +191,7 @@ void CustomCore::spawn(int n)
 
 void CustomCore::galoSengen()
 {
-    GaloSengen gs(rules.width, rules.height, rules.minScore, "pbygr");
+    GaloSengen gs(rules, std::string("pbygrcv").substr(0, rules.numColors));
 
     std::vector<std::string> bored(rules.height, std::string(rules.width, '.'));
 
@@ -187,6 +202,8 @@ void CustomCore::galoSengen()
         , {Color::YELLOW , 'y'}
         , {Color::GREEN  , 'g'}
         , {Color::RED    , 'r'}
+        , {Color::CYAN   , 'c'}
+        , {Color::VIOLET , 'v'}
     };
 
     for (unsigned r=0; r<rules.height; ++r)
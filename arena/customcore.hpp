@@ -28,6 +28,8 @@
 #ifndef CUSTOMCORE_H
 #define CUSTOMCORE_H
 
+#include "../rules.hpp"
+
 #include <set>
 #include <vector>
 #include <random>
@@ -75,7 +77,7 @@ public:
         bool operator!=(const Loc& in) const;
     };
 
-    CustomCore(int i, int j);
+    CustomCore(int i, int j, const Rules& r);
 
     void go();
     void tick();
@@ -97,15 +99,7 @@ public:
     bool isScoreTile(const Loc& l) const;
 
 private:
-    struct
-    {
-        int numColors;
-        int swapSpawn;
-        int scoreSpawn;
-        int width;
-        int height;
-        int minScore;
-    } rules;
+    Rules rules;
 
     std::vector<Color> board;
 
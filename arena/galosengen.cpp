@@ -160,26 +160,29 @@ static bool comp(T1 a1, T2 a2, T3 a3, T1 b1, T2 b2, T3 b3)
     return false;
 }
 
-GaloSengen::GaloSengen(int w, int h, int ms, Array c)
-    : width(w)
-    , height(h)
-    , minScore(std::max(ms,3))
+GaloSengen::GaloSengen(const Rules& rules, Array c)
+    : width(rules.width)
+    , height(rules.height)
+    , minScore(std::max(rules.minScore,3))
     , colors(c)
     , colorVals()
     , scoreZone()
     , normalAI()
     , panicAI()
     , inverseSpecs()
+    , evaluations(0)
 {
     for (int i=0; i<colors.size(); ++i)
     {
         colorVals[c[i]] = i+2;
     }
 
-    for (int r=2; r<height-2; ++r)
+    for (int r=0; r<height; ++r)
     {
-        for (int c=0; c<2; ++c)           scoreZone.push_back(Loc(r, c));
-        for (int c=width-2; c<width; ++c) scoreZone.push_back(Loc(r, c));
+        for (int c=0; c<width; ++c)
+        {
+            if (rules.isScoreTile(r, c)) scoreZone.push_back(Loc(r, c));
+        }
     }
 
     panicAI.push_back(&BoardInfo::need);
@@ -271,7 +274,8 @@ void GaloSengen::loadAI(AISpec& ai, const char* filename)
 Ptr<Action> GaloSengen::play(Board board)
 {
 #ifdef INU_PROFILE
-    ScopedProfile _sp(profiler, "play()");
+    static const Profiler::Zone zone ("play()");
+    ScopedProfile _sp(profiler, zone);
 #endif // INU_PROFILE
 
     clean(board);
@@ -288,7 +292,8 @@ Ptr<Action> GaloSengen::play(Board board)
 
     {
 #ifdef INU_PROFILE
-        ScopedProfile _sp(profiler, "Swap AI");
+        static const Profiler::Zone zone ("Swap AI");
+        ScopedProfile _sp(profiler, zone);
 #endif // INU_PROFILE
 
         std::vector<Loc> locs;
@@ -311,7 +316,8 @@ Ptr<Action> GaloSengen::play(Board board)
 
         {
 #ifdef INU_PROFILE
-            ScopedProfile _sp(profiler, "Best Swap");
+            static const Profiler::Zone zone ("Best Swap");
+            ScopedProfile _sp(profiler, zone);
 #endif // INU_PROFILE
 
             for (unsigned i=0; i<locs.size()-1; ++i)
@@ -323,7 +329,8 @@ Ptr<Action> GaloSengen::play(Board board)
                     if (cellA == cellB) continue;
 
 #ifdef INU_PROFILE
-                    ScopedProfile _sp(profiler, "Test Swap");
+                    static const Profiler::Zone zone ("Test Swap");
+                    ScopedProfile _sp(profiler, zone);
 #endif // INU_PROFILE
 
                     std::swap(cellA, cellB);
@@ -420,7 +427,8 @@ int GaloSengen::fillGroups(const Board& board, LocGroup& groups) const
 int GaloSengen::weakGroups(const Board& board) const
 {
 #ifdef INU_PROFILE
-    ScopedProfile _sp(profiler, "weakGroups()");
+    static const Profiler::Zone zone ("weakGroups()");
+    ScopedProfile _sp(profiler, zone);
 #endif // INU_PROFILE
 
     class Iter
@@ -473,9 +481,12 @@ int GaloSengen::weakGroups(const Board& board) const
 Ptr<GaloSengen::BoardInfo> GaloSengen::getInfo(const Board& board)
 {
 #ifdef INU_PROFILE
-    ScopedProfile _sp(profiler, "getInfo");
+    static const Profiler::Zone zone ("getInfo");
+    ScopedProfile _sp(profiler, zone);
 #endif // INU_PROFILE
 
+    ++evaluations;
+
     typedef std::set<LocGroup::Group> SG;
 
     BoardInfo* rval = new BoardInfo(width, height);
@@ -499,8 +510,17 @@ Ptr<GaloSengen::BoardInfo> GaloSengen::getInfo(const Board& board)
 
     {
 #ifdef INU_PROFILE
-        ScopedProfile _sp(profiler, "Group Sizes");
+        static const Profiler::Zone zone ("Group Sizes");
+        ScopedProfile _sp(profiler, zone);
+#endif // INU_PROFILE
+
+        {
+#ifdef INU_PROFILE
+            static const Profiler::Zone zone ("Get Sizes");
+            ScopedProfile _sp(profiler, zone);
 #endif // INU_PROFILE
+            grp2gsz = *rval->groups.getSizes();
+        }
 
         std::set<LocGroup::Group> grps;
         for (unsigned r=0; r<height; ++r)
@@ -508,33 +528,10 @@ Ptr<GaloSengen::BoardInfo> GaloSengen::getInfo(const Board& board)
             for (unsigned c=0; c<width; ++c)
             {
                 if (board[r][c] == EMPTY) continue;
-                LocGroup::Group p;
                 const Loc l (r, c);
-                {
-#ifdef INU_PROFILE
-                    ScopedProfile _sp(profiler, "Get Group");
-#endif // INU_PROFILE
-                    p = rval->groups.getGroup(l);
-                    loc2grp[l] = p;
-                }
-                int sz;
-                std::map<LocGroup::Group, int>::iterator szi;
-                {
-#ifdef INU_PROFILE
-                    ScopedProfile _sp(profiler, "Get Size");
-#endif // INU_PROFILE
-                    szi = grp2gsz.find(p);
-                    if (szi == grp2gsz.end())
-                    {
-                        sz = rval->groups.getSize(p);
-                        grp2gsz.insert(szi, std::make_pair(p, sz));
-                    }
-                    else
-                    {
-                        sz = szi->second;
-                    }
-                }
-                if (sz < 5) grps.insert(p);
+                LocGroup::Group p = rval->groups.getGroup(l);
+                loc2grp[l] = p;
+                if (grp2gsz[p] < 5) grps.insert(p);
             }
         }
         rval->numSmallGroups = grps.size();
@@ -546,7 +543,8 @@ Ptr<GaloSengen::BoardInfo> GaloSengen::getInfo(const Board& board)
 
     {
 #ifdef INU_PROFILE
-        ScopedProfile _sp(profiler, "Score Zone Groups");
+        static const Profiler::Zone zone ("Score Zone Groups");
+        ScopedProfile _sp(profiler, zone);
 #endif // INU_PROFILE
 
         for (ZoneIter i=scoreZone.begin(); i!=scoreZone.end(); ++i)
@@ -3,6 +3,8 @@
 
 #include "DJ.h"
 
+#include "../rules.hpp"
+
 #include <map>
 #include <sstream>
 #include <string>
@@ -77,9 +79,10 @@ public:
 
     Ptr& operator=(const Ptr& in)
     {
+        if (in.data) ++in.data->refs;
         del();
         data = in.data;
-        if (data) ++data->refs;
+        return *this;
     }
 
     void del()
@@ -243,7 +246,9 @@ public:
 
     SpecSet inverseSpecs;
 
-    GaloSengen(int w, int h, int ms, Array c);
+    unsigned long long evaluations; // getInfo() calls
+
+    GaloSengen(const Rules& rules, Array c);
     void loadAI(AISpec& ai, const char* filename);
     Ptr<Action> play(Board board);
 
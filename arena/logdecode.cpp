@@ -0,0 +1,32 @@
+#include "../inugami/binlog.hpp"
+
+#include <fstream>
+#include <iostream>
+
+using namespace std;
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2 || argc > 3) return -1;
+
+    ifstream in(argv[1], ios::binary);
+    if (!in)
+    {
+        cerr << "Can't open " << argv[1] << endl;
+        return -2;
+    }
+
+    ofstream file;
+    if (argc == 3) file.open(argv[2]);
+    ostream& out = (argc == 3)? file : cout;
+
+    try
+    {
+        Inugami::BinLog::decode(in, out);
+    }
+    catch (const Inugami::BinLogException& e)
+    {
+        cerr << e.what() << endl;
+        return -3;
+    }
+}
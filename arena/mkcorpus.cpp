@@ -0,0 +1,57 @@
+#include "../replay.hpp"
+#include "../galosengen/corpus.hpp"
+
+#include <iostream>
+#include <memory>
+
+using namespace std;
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3) return -1;
+
+    unique_ptr<CorpusWriter> out;
+    Rules rules;
+
+    for (int f=2; f<argc; ++f)
+    {
+        Replay::Player replay(argv[f]);
+
+        const Rules& rr = replay.header().rules;
+
+        if (!out)
+        {
+            rules = rr;
+            out.reset(new CorpusWriter(argv[1], rules));
+        }
+        else if (rr.width != rules.width || rr.height != rules.height)
+        {
+            cerr << argv[f] << ": board size differs, skipped." << endl;
+            continue;
+        }
+
+        int game = replay.game();
+
+        for (int i=0; i<replay.numMoves(); ++i, replay.step())
+        {
+            if (replay.game() != game)
+            {
+                out->endGame();
+                game = replay.game();
+            }
+
+            const Replay::Event& e = replay.nextMove();
+
+            CorpusMove mv;
+            mv.kind = (e.op == Replay::Event::SWAP)? CorpusMove::SWAP : CorpusMove::SCORE;
+            mv.a = e.a;
+            mv.b = e.b;
+
+            out->add(replay.board().data(), mv);
+        }
+
+        out->endGame();
+    }
+
+    out->close();
+}
@@ -0,0 +1,61 @@
+#include "galosengen.hpp"
+#include "../replay.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+int main(int argc, char* argv[])
+{
+    if (argc != 2) return -1;
+
+    Replay::Player replay(argv[1]);
+
+    const Rules& rules = replay.header().rules;
+
+    const string conv = string(".pbygrcv").substr(0, rules.numColors+1);
+    GaloSengen gs(rules, conv.substr(1));
+
+    vector<string> bored(rules.height, string(rules.width, '.'));
+
+    int same = 0;
+    double secs = 0.0;
+
+    for (int i=0; i<replay.numMoves(); ++i)
+    {
+        for (int r=0; r<rules.height; ++r)
+        {
+            for (int c=0; c<rules.width; ++c)
+            {
+                bored[r][c] = conv[replay.board()[r*rules.width+c]];
+            }
+        }
+
+        auto start = chrono::steady_clock::now();
+        string str = gs.play(bored)->str();
+        secs += chrono::duration<double>(chrono::steady_clock::now()-start).count();
+
+        const Replay::Event& e = replay.nextMove();
+
+        stringstream ss;
+        if (e.op == Replay::Event::SWAP)
+        {
+            ss << "SWAP " << e.a/rules.width << " " << e.a%rules.width
+               << " "     << e.b/rules.width << " " << e.b%rules.width;
+        }
+        else
+        {
+            ss << "SCORE " << e.a/rules.width << " " << e.a%rules.width;
+        }
+
+        if (ss.str() == str) ++same;
+
+        replay.step();
+    }
+
+    cout << replay.numMoves() << " " << same << " " << secs << endl;
+}
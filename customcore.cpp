@@ -41,12 +41,14 @@
 #include "inugami/transform.hpp"
 #include "inugami/utility.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <fstream>
 #include <utility>
 #include <random>
 
 #include <sstream>
-#include <iomanip>
 
 #include <tuple>
 
@@ -54,6 +56,34 @@
 
 using namespace Inugami;
 
+// Instance animation kinds, evaluated in shaders/crazy.vert
+enum Anim
+{
+      ANIM_NONE
+    , ANIM_SPAWN
+    , ANIM_SWAP
+    , ANIM_FLASH
+    , ANIM_SPIN  // Swap that loops, left behind by the move that ended the game
+};
+
+// Animation lengths in seconds, matching the rates in shaders/crazy.vert
+static constexpr float SPAWN_TIME = 0.225f;
+static constexpr float SWAP_TIME  = 0.3f;
+static constexpr float FLASH_TIME = 10.f/60.f;
+
+static const std::vector<Image::Pixel> PALETTE = {
+      {{128, 128, 128, 255}} // NONE
+    , {{255,   0, 255, 255}} // MAGENTA
+    , {{  0,   0, 255, 255}} // BLUE
+    , {{255, 255,   0, 255}} // YELLOW
+    , {{  0, 255,   0, 255}} // GREEN
+    , {{255,   0,   0, 255}} // RED
+    , {{  0, 255, 255, 255}} // CYAN
+    , {{128,   0, 128, 255}} // VIOLET
+    , {{  0,   0,   0, 255}} // BLACK
+    , {{255, 255, 255, 255}} // WHITE
+};
+
 bool CustomCore::Loc::operator<(const Loc& in) const
 {
     return (std::tie(r, c) < std::tie(in.r, in.c));
@@ -69,22 +99,10 @@ bool CustomCore::Loc::operator!=(const Loc& in) const
     return (std::tie(r, c) != std::tie(in.r, in.c));
 }
 
-CustomCore::CustomCore(const RenderParams &params)
+CustomCore::CustomCore(const RenderParams &params, const Rules& r)
     : Core(params)
 
-    , colors
-    {
-          {{1, 1, {128, 128, 128, 255}}, false, false} // NONE
-        , {{1, 1, {255,   0, 255, 255}}, false, false} // MAGENTA
-        , {{1, 1, {  0,   0, 255, 255}}, false, false} // BLUE
-        , {{1, 1, {255, 255,   0, 255}}, false, false} // YELLOW
-        , {{1, 1, {  0, 255,   0, 255}}, false, false} // GREEN
-        , {{1, 1, {255,   0,   0, 255}}, false, false} // RED
-        , {{1, 1, {  0, 255, 255, 255}}, false, false} // CYAN
-        , {{1, 1, {128,   0, 128, 255}}, false, false} // VIOLET
-        , {{1, 1, {  0,   0,   0, 255}}, false, false} // BLACK
-        , {{1, 1, {255, 255, 255, 255}}, false, false} // WHITE
-    }
+    , palette(PALETTE)
     , font(Image::fromPNG("data/font.png"), 16, 16)
     , panel(Geometry::fromRect(1.f, 1.f))
     , piece(Geometry::fromDisc(0.9f, 0.9f, 16))
@@ -92,12 +110,12 @@ CustomCore::CustomCore(const RenderParams &params)
 
     , shader(ShaderProgram::fromName("shaders/crazy"))
 
-    , rules{5, 5, 3, 10, 8, 5}
+    , rules(r)
 
     , board(rules.width*rules.height, Color::NONE)
 
     , selection{{-1, -1}, false}
-    , flashing{-1, Color::NONE}
+    , flashing{0.f, false}
 
     , score(0)
 
@@ -107,35 +125,67 @@ CustomCore::CustomCore(const RenderParams &params)
 
     , isGameOver(false)
 
-    , rng(time(nullptr))
+    , seed(time(nullptr))
+    , rng(seed)
+
+    , recorder()
+
+    , boardVersion(0)
+    , aiJob{{}, 0}
 
     , swapAnim{0.f, 0.f, 0.f, {{-1, -1}, {-1, -1}}}
     , spawning()
-    , spawnScale(0.f)
+    , spawnStart(0.f)
+
+    , shake{0.f, 0.f}
 
-    , screenShake(0.f)
+    , epoch(std::chrono::steady_clock::now())
+    , uniforms{{}, {}}
 
     , prevScore(-1)
     , highScore(-1)
     , pointList()
 
     , scoreZone()
+
+    , frames()
+
+    , text(font)
+    , scoreText(12)
+    , valueText(1)
 {
-    ScopedProfile prof(profiler, "CustomCore: Constructor");
+    static const Profiler::Zone zone ("CustomCore: Constructor");
+    ScopedProfile prof(profiler, zone);
+
+    //Recording is optional, so an unwritable directory doesn't stop the game
+    try
+    {
+        recorder.reset(new Replay::Writer("replay.sbr", {rules, seed}));
+    }
+    catch (const Replay::Error& e)
+    {
+        logger->log<1>(e.what(), " Not recording.");
+    }
 
     logger->log<5>("Adding callbacks...");
-    addCallback([&]{tick();draw();}, 60.0);
+    setUpdate([&]{tick();}, 60.0);
+    addCallback([&]{draw();}, 60.0);
 
     setWindowTitle("Inu SuperBall", true);
 
     setShader(shader);
     shader.setUniform("screenres", Vec2{getParams().width, getParams().height});
 
+    uniforms.time  = getShader().getUniformID("Time");
+    uniforms.shake = getShader().getUniformID("Shake");
+
 #if 1
-    for (int r=2; r<rules.height-2; ++r)
+    for (int r=0; r<rules.height; ++r)
     {
-        for (int c=0; c<2; ++c) scoreZone.insert({r, c});
-        for (int c=rules.width-2; c<rules.width; ++c) scoreZone.insert({r, c});
+        for (int c=0; c<rules.width; ++c)
+        {
+            if (rules.isScoreTile(r, c)) scoreZone.insert({r, c});
+        }
     }
 #else
     {
@@ -153,7 +203,8 @@ CustomCore::CustomCore(const RenderParams &params)
 
 void CustomCore::tick()
 {
-    ScopedProfile prof(profiler, "CustomCore: Tick");
+    static const Profiler::Zone zone ("CustomCore: Tick", true);
+    ScopedProfile prof(profiler, zone);
 
     //Keybinds can be stored in proxies
     auto keyAI    = iface->getProxy(' '_ivk);
@@ -178,24 +229,31 @@ void CustomCore::tick()
         gameOver();
     }
 
-    if (!isGameOver && keyFast) executeAI();
+    pollAI();
+
+    //Holding this keeps a request in flight at all times
+    if (!isGameOver && keyFast) requestAI();
 
     if (keyAI.pressed())
     {
         if (isGameOver) gameOver();
-        else executeAI();
+        else requestAI();
     }
 
     if (keyFlood.pressed())
     {
+        ++boardVersion;
         for (Color& c : board) c = Color::RED;
+        for (int i=0; i<int(board.size()) && recorder; ++i) recorder->spawn(i, int(Color::RED));
     }
 
     auto mPos = iface->getMousePos();
     float mx = mPos.x/10.0;
     float my = mPos.y/10.0-5.f;
 
-    Loc loc{my/6.f, mx/6.f};
+    const float pitch = cellPitch();
+
+    Loc loc{int(std::floor(my/pitch)), int(std::floor(mx/pitch))};
 
     hoverCell.r = loc.r;
     hoverCell.c = loc.c;
@@ -231,53 +289,132 @@ void CustomCore::tick()
     {
         clearSelect();
     }
+
+    buildFrame(frames.back());
+    frames.publish();
 }
 
 void CustomCore::draw()
 {
-    ScopedProfile prof(profiler, "CustomCore: Draw");
+    //Nothing new from tick() means the last frame is still on screen
+    if (!frames.acquire() && !frames.front().animating) return;
+
+    static const Profiler::Zone zone ("CustomCore: Draw", true);
+    ScopedProfile prof(profiler, zone);
+
+    static auto& frameSeconds = metrics->histogram("superball_frame_seconds", "Time spent drawing a frame.", Metrics::exponentialBounds(0.001, 2.0, 8));
+    static auto& frameTotal   = metrics->counter("superball_frames_total", "Frames drawn.");
+    static auto& drawCalls    = metrics->counter("superball_draw_calls_total", "OpenGL draw calls.");
+    static auto& frameRate    = metrics->gauge("superball_frame_rate", "Average frames per second.");
+    static std::uint64_t lastDrawCalls = 0;
+
+    const auto start = std::chrono::steady_clock::now();
+
+    const Frame& f = frames.front();
 
     //beginFrame() sets the OpenGL context to the proper initial state
     beginFrame();
 
     {
-        ScopedProfile prof(profiler, "2D");
-
-        std::uniform_real_distribution<float> shake(-screenShake, screenShake);
-        screenShake *= 0.9f;
-
-        float s1 = shake(rng);
-        float s2 = shake(rng);
+        static const Profiler::Zone zone ("2D");
+        ScopedProfile prof(profiler, zone);
 
         Camera cam;
-        cam.ortho(-40.f+s1, 40.f+s1, -30.f+s2, 30.f+s2, -1.f, 1.f);
+        cam.ortho(-40.f, 40.f, -30.f, 30.f, -1.f, 1.f);
         applyCam(cam);
 
-        if (flashing.timer <= 0)
+        const float time = std::chrono::duration<float>(std::chrono::steady_clock::now()-f.epoch).count();
+        getShader().setUniform(uniforms.time, time);
+        getShader().setUniform(uniforms.shake, f.shake);
+
+        palette.bind(0);
+
+        if (!f.flash)
         {
-            drawBoard();
-            drawLinks();
-            drawScore();
+            modelMatrix(boardTransform());
+
+            panel.drawInstanced(f.panels);
+            piece.drawInstanced(f.pieces);
+            diamond.drawInstanced(f.diamonds);
+            diamond.drawInstanced(f.links);
+
+            modelMatrix(Transform());
+
+            text.clear();
+            for (auto& line : f.lines) text.add(line.first, line.second);
+            text.draw();
+
+            palette.bind(0);
+            piece.drawInstanced(f.swatches);
         }
         else
         {
-            drawFlash();
+            modelMatrix(Transform());
+            panel.drawInstanced(f.panels);
         }
     }
 
     //endFrame() swaps the buffer to the screen
     endFrame();
+
+    frameSeconds.observe(std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count());
+    frameTotal.add();
+    drawCalls.add(Mesh::getDrawCalls()-lastDrawCalls);
+    lastDrawCalls = Mesh::getDrawCalls();
+    frameRate.set(getAverageFrameRate());
 }
 
-void CustomCore::drawBoard()
+void CustomCore::buildFrame(Frame& f)
 {
-    Transform mat;
+    const float now = animTime();
 
-    constexpr float panelSize = 5.f;
+    if (!spawning.empty() && now-spawnStart >= SPAWN_TIME) spawning.clear();
 
-    mat.translate(Vec3{-40.f, 30.f, 0.f});
-    mat.scale(Vec3{panelSize, panelSize, 1.f});
-    mat.translate(Vec3{0.6f, -1.6f, 0.f});
+    if (swapAnim.c[0].r != -1 && !isGameOver && now-swapAnim.start >= SWAP_TIME)
+    {
+        swapAnim.c[0] = {-1, -1};
+        swapAnim.c[1] = {-1, -1};
+    }
+
+    if (flashing.on && now-flashing.start >= FLASH_TIME) flashing.on = false;
+
+    const bool shaking = (shakeAt(now) >= 0.01f);
+
+    //Keep animation times small enough for float precision
+    if (now > 3600.f && spawning.empty() && swapAnim.c[0].r == -1 && !flashing.on && !shaking)
+    {
+        epoch = std::chrono::steady_clock::now();
+        shake = {0.f, 0.f};
+    }
+
+    f.epoch = epoch;
+    f.shake = Vec2{shake.amp, shake.start};
+    f.animating = (!spawning.empty() || swapAnim.c[0].r != -1 || flashing.on || shaking);
+
+    f.panels.clear();
+    f.pieces.clear();
+    f.diamonds.clear();
+    f.links.clear();
+    f.swatches.clear();
+    f.lines.clear();
+
+    f.flash = flashing.on;
+
+    if (!f.flash)
+    {
+        buildBoard(f);
+        buildLinks(f);
+        buildScore(f);
+    }
+    else
+    {
+        buildFlash(f);
+    }
+}
+
+void CustomCore::buildBoard(Frame& f)
+{
+    const Vec3 unit{1.f, 1.f, 1.f};
 
     for (int r=0; r<rules.height; ++r)
     {
@@ -285,13 +422,8 @@ void CustomCore::drawBoard()
         {
             const Loc loc = {r, c};
 
-            mat.push();
-
             Vec3 toPanel{c*1.2f, r*-1.2f, 0.f};
 
-            mat.translate(toPanel);
-            modelMatrix(mat);
-
             Color pc = isGameOver? Color::BLACK : Color::NONE;
 
             if (selection.on && selection.loc == loc)
@@ -299,8 +431,7 @@ void CustomCore::drawBoard()
                 pc = Color::WHITE;
             }
 
-            colors[int(pc)].bind(0);
-            panel.draw();
+            f.panels.push_back({toPanel, unit, palette[int(pc)]});
 
             Color& cell = cellAt(loc);
 
@@ -308,87 +439,41 @@ void CustomCore::drawBoard()
              && (swapAnim.c[1] != loc)
              && cell != Color::NONE)
             {
-                colors[int(cell)].bind(0);
-
                 if (spawning.find(&cell) != end(spawning))
                 {
-                    mat.push();
-
-                    mat.scale(Vec3{spawnScale, spawnScale, 1.f});
-                    modelMatrix(mat);
-
-                    piece.draw();
-
-                    mat.pop();
-                    modelMatrix(mat);
+                    f.pieces.push_back({toPanel, unit, palette[int(cell)], Vec4{ANIM_SPAWN, spawnStart, 0.f, 0.f}});
                 }
                 else
                 {
-                    piece.draw();
+                    f.pieces.push_back({toPanel, unit, palette[int(cell)]});
                 }
             }
 
             if (isScoreTile(loc))
             {
-                colors[int(Color::WHITE)].bind(0);
-                diamond.draw();
+                f.diamonds.push_back({toPanel, unit, palette[int(Color::WHITE)]});
             }
-
-            mat.pop();
-        }
-    }
-
-    if (spawning.size() > 0)
-    {
-        spawnScale *= 1.25f;
-
-        if (spawnScale >= 1.f)
-        {
-            spawnScale = 0.05f;
-            spawning.clear();
         }
     }
 
     if (swapAnim.c[0].r != -1) //lazy check
     {
-        Vec3 toRotCent{swapAnim.px*1.2f, swapAnim.py*-1.2f, 0.f};
+        const float kind = (isGameOver)? ANIM_SPIN : ANIM_SWAP;
+        const Vec4 anim{kind, swapAnim.start, swapAnim.px*1.2f, swapAnim.py*-1.2f};
+
         for (int i=0; i<2; ++i)
         {
             Loc& l = swapAnim.c[i];
             Color col = cellAt(swapAnim.c[1-i]);
 
-            colors[int(col)].bind(0);
-
-            mat.push();
-
             Vec3 toPanel{l.c*1.2f, l.r*-1.2f, 0.f};
 
-            float rate = (2.f-sind(swapAnim.deg))/2.f;
-
-            mat.translate(toRotCent);
-            mat.rotate(swapAnim.deg, Vec3{0.f, 0.f, 1.f});
-            mat.translate((-toRotCent+toPanel)*rate);
-            modelMatrix(mat);
-
-            piece.draw();
-
-            swapAnim.deg += 5.f;
-            if (swapAnim.deg >= 180.f)
-            {
-                swapAnim.deg = 0.f;
-                if (!isGameOver)
-                {
-                    swapAnim.c[0] = {-1, -1};
-                    swapAnim.c[1] = {-1, -1};
-                }
-            }
-
-            mat.pop();
+            f.pieces.push_back({toPanel, unit, palette[int(col)], anim});
         }
     }
 }
 
-void CustomCore::drawScore()
+void CustomCore::buildScore(Frame& f)
 {
     Transform mat;
 
@@ -400,14 +485,7 @@ void CustomCore::drawScore()
     {
         mat.push();
         mat.scale(Vec3{0.5f, 0.5f, 1.f});
-
-        for (char c : in)
-        {
-            modelMatrix(mat);
-            font.draw(c/16, c%16);
-            mat.translate(Vec3{16.f, 0.f, 0.f});
-        }
-
+        f.lines.emplace_back(mat, in);
         mat.pop();
     };
 
@@ -415,9 +493,7 @@ void CustomCore::drawScore()
     {
         mat.push();
         mat.translate(Vec3{4.f, 0.f, 0.f});
-        std::stringstream ss;
-        ss << std::setw(12) << std::setfill(' ') << num;
-        drawString(ss.str());
+        drawString(scoreText(num));
         mat.pop();
     };
 
@@ -452,13 +528,10 @@ void CustomCore::drawScore()
         mat.translate(Vec3{4.f, -8.f, 0.f});
         mat.push();
         mat.scale(Vec3{12.f, 12.f, 1.f});
-        colors[i+1].bind(0);
-        modelMatrix(mat);
-        piece.draw();
+        const Mat4 m = mat;
+        f.swatches.push_back({Vec3(m*Vec4{0.f, 0.f, 0.f, 1.f}), Vec3{m[0][0], m[1][1], 1.f}, palette[int(Color(i+1))]});
         mat.pop();
-        std::stringstream ss;
-        ss << colorVal(Color(i+1));
-        drawString(ss.str());
+        drawString(valueText(colorVal(Color(i+1))));
         mat.pop();
 
         mat.translate(Vec3{20.f, 0.f, 0.f});
@@ -466,7 +539,7 @@ void CustomCore::drawScore()
     }
 }
 
-void CustomCore::drawLinks()
+void CustomCore::buildLinks(Frame& f)
 {
     if (hoverCell.r<0 || hoverCell.r>=rules.height
      || hoverCell.c<0 || hoverCell.c>=rules.width)
@@ -474,60 +547,31 @@ void CustomCore::drawLinks()
         return;
     }
 
-    Transform mat;
-
-    constexpr float panelSize = 5.f;
-
     Color rain = cellAt(hoverCell);
-    colors[int(rain)].bind(0);
 
-    mat.translate(Vec3{-40.f, 30.f, 0.f});
-    mat.scale(Vec3{panelSize, panelSize, 1.f});
-    mat.translate(Vec3{0.6f, -1.6f, 0.f});
+    const Vec3 unit{1.f, 1.f, 1.f};
 
     for (const Loc& l : hoverGroup)
     {
-        mat.push();
-        mat.translate(Vec3{l.c*1.2f, l.r*-1.2f, 0.f});
+        Vec3 toPanel{l.c*1.2f, l.r*-1.2f, 0.f};
 
         if (hoverGroup.find({l.r+1, l.c}) != end(hoverGroup))
         {
-            mat.push();
-            mat.translate(Vec3{0.f, -0.6f, 0.f});
-            modelMatrix(mat);
-            diamond.draw();
-            mat.pop();
+            f.links.push_back({toPanel+Vec3{0.f, -0.6f, 0.f}, unit, palette[int(rain)]});
         }
 
         if (hoverGroup.find({l.r, l.c+1}) != end(hoverGroup))
         {
-            mat.push();
-            mat.translate(Vec3{0.6f, 0.f, 0.f});
-            modelMatrix(mat);
-            diamond.draw();
-            mat.pop();
+            f.links.push_back({toPanel+Vec3{0.6f, 0.f, 0.f}, unit, palette[int(rain)]});
         }
-
-        mat.pop();
     }
 }
 
-void CustomCore::drawFlash()
+void CustomCore::buildFlash(Frame& f)
 {
-    Transform mat;
-    mat.scale(Vec3{80.f, 60.f, 1.f});
-    modelMatrix(mat);
-
-    Color fc = flashing.color;
-
-    colors[int(fc)].bind(0);
-
-    panel.draw();
-
-    if (flashing.color == Color::RED) flashing.color = Color::WHITE;
-    else flashing.color = Color::RED;
+    const Vec4 anim{ANIM_FLASH, flashing.start, 0.f, 0.f};
 
-    --flashing.timer;
+    f.panels.push_back({Vec3{0.f, 0.f, 0.f}, Vec3{80.f, 60.f, 1.f}, palette[int(Color::RED)], anim});
 }
 
 CustomCore::Color& CustomCore::cellAt(const Loc& loc)
@@ -564,14 +608,15 @@ void CustomCore::swapCells(const Loc& a, const Loc& b, bool force)
     if (!force && cell1 == cell2) return flash();
 
     std::swap(cell1, cell2);
+    if (recorder) recorder->swap(indexOf(a), indexOf(b));
 
     swapAnim.c[0] = a;
     swapAnim.c[1] = b;
-    swapAnim.deg = 0.f;
+    swapAnim.start = animTime();
     swapAnim.px = (a.c+b.c)/2.f;
     swapAnim.py = (a.r+b.r)/2.f;
 
-    return spawn(5);
+    return spawn(rules.swapSpawn);
 }
 
 void CustomCore::scoreCell(const Loc& loc)
@@ -584,7 +629,9 @@ void CustomCore::scoreCell(const Loc& loc)
     bool isScoring = getGroup(loc, cell, group);
 
     if (!isScoring)       return flash();
-    if (group.size() < 5) return flash();
+    if (group.size() < std::size_t(rules.minScore)) return flash();
+
+    if (recorder) recorder->score(indexOf(loc));
 
     int s = colorVal(cell) * group.size();
 
@@ -596,37 +643,52 @@ void CustomCore::scoreCell(const Loc& loc)
 
     shake_n_bake(s);
 
-    return spawn(3);
+    return spawn(rules.scoreSpawn);
 }
 
 bool CustomCore::getGroup(const Loc& loc, Color k, std::set<Loc>& s)
 {
-    Color& cell = cellAt(loc);
-    if (cell != k) return false;
-
+    if (cellAt(loc) != k) return false;
     if (!s.insert(loc).second) return false;
 
-    bool isScoring = isScoreTile(loc);
+    bool isScoring = false;
 
     int a = rules.height-1;
     int b = rules.width-1;
 
-    if (loc.r>0) isScoring += getGroup({loc.r-1, loc.c}, k, s);
-    if (loc.r<a) isScoring += getGroup({loc.r+1, loc.c}, k, s);
-    if (loc.c>0) isScoring += getGroup({loc.r, loc.c-1}, k, s);
-    if (loc.c<b) isScoring += getGroup({loc.r, loc.c+1}, k, s);
+    std::vector<Loc> stack{loc};
+
+    auto visit = [&](const Loc& l)
+    {
+        if (cellAt(l) == k && s.insert(l).second) stack.push_back(l);
+    };
+
+    while (!stack.empty())
+    {
+        Loc l = stack.back();
+        stack.pop_back();
+
+        isScoring |= isScoreTile(l);
+
+        if (l.r>0) visit({l.r-1, l.c});
+        if (l.r<a) visit({l.r+1, l.c});
+        if (l.c>0) visit({l.r, l.c-1});
+        if (l.c<b) visit({l.r, l.c+1});
+    }
 
     return isScoring;
 }
 
 void CustomCore::flash()
 {
-    flashing.timer = 10;
-    flashing.color = Color::RED;
+    flashing.start = animTime();
+    flashing.on = true;
 }
 
 void CustomCore::spawn(int n)
 {
+    ++boardVersion;
+
     std::vector<Color*> nones;
 
     for (Color& c : board)
@@ -641,18 +703,21 @@ void CustomCore::spawn(int n)
     std::uniform_int_distribution<int> pick(1,rules.numColors);
 
     spawning.clear();
-    spawnScale = 0.05f;
+    spawnStart = animTime();
 
     for (int i=0; i<n; ++i)
     {
         *nones[i] = Color(pick(rng));
         spawning.insert(nones[i]);
+        if (recorder) recorder->spawn(nones[i]-&board[0], int(*nones[i]));
     }
 }
 
-void CustomCore::executeAI()
+void CustomCore::requestAI()
 {
-    ExternalAI ai("./sb-play", rules.width, rules.height, rules.minScore, "pbygr");
+    if (aiJob.move.valid()) return;
+
+    const std::string letters = std::string("pbygrcv").substr(0, rules.numColors);
 
     std::vector<std::string> bored(rules.height, std::string(rules.width, '.'));
 
@@ -663,6 +728,8 @@ void CustomCore::executeAI()
         , {Color::YELLOW , 'y'}
         , {Color::GREEN  , 'g'}
         , {Color::RED    , 'r'}
+        , {Color::CYAN   , 'c'}
+        , {Color::VIOLET , 'v'}
     };
 
     std::map<char, char> conv2 = {
@@ -672,6 +739,8 @@ void CustomCore::executeAI()
         , {'y', 'Y'}
         , {'g', 'G'}
         , {'r', 'R'}
+        , {'c', 'C'}
+        , {'v', 'V'}
     };
 
     for (unsigned r=0; r<rules.height; ++r)
@@ -683,9 +752,44 @@ void CustomCore::executeAI()
         }
     }
 
-    auto str = ai.play(bored);
+    ExternalAI ai("./sb-play", rules.width, rules.height, rules.minScore, letters);
 
-    logger->log<3>(str);
+    aiJob.version = boardVersion;
+    aiJob.move = std::async(std::launch::async, [ai, bored]() mutable
+    {
+        static const Profiler::Zone zone ("CustomCore: AI Move", true);
+        ScopedProfile prof(profiler, zone);
+
+        static auto& moveSeconds = metrics->histogram("superball_ai_move_seconds", "Time taken by the AI to pick a move.", Metrics::exponentialBounds(0.01, 2.0, 12));
+
+        const auto start = std::chrono::steady_clock::now();
+        std::string move = ai.play(bored);
+        moveSeconds.observe(std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count());
+
+        return move;
+    });
+}
+
+void CustomCore::pollAI()
+{
+    if (!aiJob.move.valid()) return;
+
+    if (aiJob.move.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return;
+
+    auto str = aiJob.move.get();
+
+    if (aiJob.version != boardVersion || isGameOver)
+    {
+        INU_LOG(logger, 3, "Discarding stale move: {}", str);
+        return;
+    }
+
+    applyAI(str);
+}
+
+void CustomCore::applyAI(const std::string& str)
+{
+    INU_LOG(logger, 3, "Move: {}", str);
 
     std::stringstream ss(str);
 
@@ -713,7 +817,19 @@ void CustomCore::executeAI()
 
 void CustomCore::shake_n_bake(int s)
 {
-    screenShake += s/10.f;
+    const float now = animTime();
+    shake.amp = shakeAt(now) + s/10.f;
+    shake.start = now;
+}
+
+float CustomCore::shakeAt(float t) const
+{
+    return shake.amp * std::pow(0.9f, 60.f*(t-shake.start));
+}
+
+float CustomCore::animTime() const
+{
+    return std::chrono::duration<float>(std::chrono::steady_clock::now()-epoch).count();
 }
 
 int CustomCore::colorVal(Color c) const
@@ -734,11 +850,36 @@ void CustomCore::gameOver()
     if (score > highScore) highScore = score;
     score = 0;
     for (Color& c : board) c = Color::NONE;
+    if (recorder) recorder->reset();
     spawn(rules.swapSpawn);
     pointList.clear();
+    if (recorder) recorder->flush();
 }
 
 bool CustomCore::isScoreTile(const Loc& loc) const
 {
     return (scoreZone.find(loc) != end(scoreZone));
 }
+
+int CustomCore::indexOf(const Loc& loc) const
+{
+    return loc.r*rules.width+loc.c;
+}
+
+float CustomCore::cellPitch() const
+{
+    return std::min({6.f, 60.f/rules.width, 55.f/rules.height});
+}
+
+Transform CustomCore::boardTransform() const
+{
+    Transform rval;
+
+    const float panelSize = cellPitch()/1.2f;
+
+    rval.translate(Vec3{-40.f, 25.f, 0.f});
+    rval.scale(Vec3{panelSize, panelSize, 1.f});
+    rval.translate(Vec3{0.6f, -0.6f, 0.f});
+
+    return rval;
+}
@@ -28,15 +28,28 @@
 #ifndef CUSTOMCORE_H
 #define CUSTOMCORE_H
 
+#include "replay.hpp"
+#include "rules.hpp"
+
 #include "inugami/core.hpp"
 
 #include "inugami/animatedsprite.hpp"
 #include "inugami/mesh.hpp"
+#include "inugami/palette.hpp"
 #include "inugami/shader.hpp"
 #include "inugami/spritesheet.hpp"
+#include "inugami/textbatch.hpp"
 #include "inugami/texture.hpp"
+#include "inugami/transform.hpp"
+#include "inugami/utility.hpp"
 
+#include <chrono>
+#include <future>
+#include <memory>
 #include <set>
+#include <string>
+#include <utility>
+#include <vector>
 
 class CustomCore
     : public Inugami::Core
@@ -70,16 +83,11 @@ public:
         bool operator!=(const Loc& in) const;
     };
 
-    CustomCore(const RenderParams &params);
+    CustomCore(const RenderParams &params, const Rules& r);
 
     void tick();
     void draw();
 
-    void drawBoard();
-    void drawScore();
-    void drawLinks();
-    void drawFlash();
-
     Color& cellAt(const Loc& l);
 
     void selectCell(const Loc& l);
@@ -93,9 +101,14 @@ public:
 
     void spawn(int n);
 
-    void executeAI();
+    void requestAI();
+    void pollAI();
+    void applyAI(const std::string& move);
 
     void shake_n_bake(int s);
+    float shakeAt(float t) const;
+
+    float animTime() const;
 
     int colorVal(Color c) const;
 
@@ -103,8 +116,49 @@ public:
 
     bool isScoreTile(const Loc& l) const;
 
+    int indexOf(const Loc& l) const;
+
+    float cellPitch() const;
+    Inugami::Transform boardTransform() const;
+
 private:
-    Inugami::Texture     colors[int(Color::COUNT)];
+    // Everything draw() needs, built by tick() on the update thread
+    struct Frame
+    {
+        Frame()
+            : epoch()
+            , shake()
+            , flash(false)
+            , animating(false)
+            , panels()
+            , pieces()
+            , diamonds()
+            , links()
+            , swatches()
+            , lines()
+        {}
+
+        std::chrono::steady_clock::time_point epoch;
+        Inugami::Vec2 shake;
+        bool flash;
+        bool animating;
+
+        std::vector<Inugami::Mesh::Instance> panels;
+        std::vector<Inugami::Mesh::Instance> pieces;
+        std::vector<Inugami::Mesh::Instance> diamonds;
+        std::vector<Inugami::Mesh::Instance> links;
+        std::vector<Inugami::Mesh::Instance> swatches;
+
+        std::vector<std::pair<Inugami::Mat4, std::string>> lines;
+    };
+
+    void buildFrame(Frame& f);
+    void buildBoard(Frame& f);
+    void buildScore(Frame& f);
+    void buildLinks(Frame& f);
+    void buildFlash(Frame& f);
+
+    Inugami::Palette     palette;
     Inugami::Spritesheet font;
 
     Inugami::Mesh    panel;
@@ -113,20 +167,12 @@ private:
 
     Inugami::Shader  shader;
 
-    struct
-    {
-        int numColors;
-        int swapSpawn;
-        int scoreSpawn;
-        int width;
-        int height;
-        int minScore;
-    } rules;
+    Rules rules;
 
     std::vector<Color> board;
 
     struct {Loc loc; bool on;} selection;
-    struct {int timer; Color color;} flashing;
+    struct {float start; bool on;} flashing;
 
     int score;
 
@@ -136,13 +182,24 @@ private:
 
     bool isGameOver;
 
+    std::uint32_t seed;
     std::mt19937 rng;
 
-    struct {float px, py, deg; Loc c[2];} swapAnim;
+    std::unique_ptr<Replay::Writer> recorder; // Null if replay.sbr can't be written
+
+    // Bumped on every board change, so stale AI moves can be dropped
+    unsigned boardVersion;
+    struct {std::future<std::string> move; unsigned version;} aiJob;
+
+    struct {float px, py, start; Loc c[2];} swapAnim;
     std::set<Color*> spawning;
-    float spawnScale;
+    float spawnStart;
 
-    float screenShake;
+    struct {float amp, start;} shake;
+
+    //Animation times are seconds since this, uploaded as the Time uniform
+    std::chrono::steady_clock::time_point epoch;
+    struct {Inugami::Shader::UniformID time, shake;} uniforms;
 
     int prevScore;
     int highScore;
@@ -150,6 +207,12 @@ private:
     std::vector<int> pointList;
 
     std::set<Loc> scoreZone;
+
+    Inugami::TripleBuffer<Frame> frames;
+
+    Inugami::TextBatch  text;
+    Inugami::NumberText scoreText;
+    Inugami::NumberText valueText;
 };
 
 #endif // CUSTOMCORE_H
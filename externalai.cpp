@@ -31,7 +31,7 @@ std::string ExternalAI::play(std::vector<std::string> const& board)
         for (auto&& line : board)
         {
             process.in() << line << "\n";
-            logger->log<1>(line);
+            INU_LOG(logger, 1, "Board: {}", line);
         }
         process.in() << "\n";
         process.in().flush();
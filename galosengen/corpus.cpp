@@ -0,0 +1,325 @@
+#include "corpus.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#else
+    #include <iterator>
+#endif // _WIN32
+
+static const char MAGIC[4] = {'I', 'S', 'B', 'C'};
+static const std::uint16_t VERSION = 2;
+static const std::size_t HEADER_SIZE = 64;
+static const std::size_t BOARD_OFFSET = 16;
+
+template <typename T>
+static T peek(const unsigned char* p)
+{
+    T rval;
+    std::memcpy(&rval, p, sizeof(T));
+    return rval;
+}
+
+template <typename T>
+static void poke(unsigned char* p, T val)
+{
+    std::memcpy(p, &val, sizeof(T));
+}
+
+static std::size_t recordSizeFor(int w, int h)
+{
+    std::size_t sz = BOARD_OFFSET + (w*h+1)/2;
+    return (sz+7)/8*8;
+}
+
+CorpusError::CorpusError(const std::string& what)
+    : std::runtime_error("Corpus: "+what)
+{}
+
+/* Corpus::Record --                  --                    -- Corpus::Record */
+
+Corpus::Record::Record(const Corpus& c, const unsigned char* p)
+    : corpus(&c)
+    , data(p)
+{}
+
+std::uint32_t Corpus::Record::game() const
+{
+    return peek<std::uint32_t>(data);
+}
+
+std::uint32_t Corpus::Record::move() const
+{
+    return peek<std::uint32_t>(data+4);
+}
+
+CorpusMove Corpus::Record::played() const
+{
+    CorpusMove rval;
+    rval.kind = CorpusMove::Kind(data[8]);
+    rval.a = peek<std::uint16_t>(data+10);
+    rval.b = peek<std::uint16_t>(data+12);
+    return rval;
+}
+
+int Corpus::Record::cellAt(int r, int c) const
+{
+    const int i = r*corpus->w+c;
+    const unsigned char byte = data[BOARD_OFFSET+i/2];
+    return (i%2)? (byte>>4) : (byte&0x0F);
+}
+
+/* Corpus --                          --                            -- Corpus */
+
+Corpus::Corpus(const std::string& filename)
+    : base(0)
+    , length(0)
+    , fallback()
+    , w(0), h(0), colors(0), minimum(0)
+    , zoneRows(0), zoneCols(0)
+    , recordSize(0)
+    , records(0)
+    , games(0)
+    , recordData(0)
+    , indexData(0)
+{
+#ifndef _WIN32
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) throw CorpusError("Can't open "+filename+"!");
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < off_t(HEADER_SIZE))
+    {
+        ::close(fd);
+        throw CorpusError(filename+" is not a corpus!");
+    }
+
+    length = st.st_size;
+    void* p = mmap(0, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+
+    if (p == MAP_FAILED) throw CorpusError("Can't map "+filename+"!");
+
+    madvise(p, length, MADV_SEQUENTIAL);
+    base = static_cast<const unsigned char*>(p);
+#else
+    std::ifstream file(filename.c_str(), std::ios::binary);
+    if (!file) throw CorpusError("Can't open "+filename+"!");
+    fallback.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    base = fallback.data();
+    length = fallback.size();
+#endif // _WIN32
+
+    try
+    {
+        parse();
+    }
+    catch (...)
+    {
+#ifndef _WIN32
+        munmap(const_cast<unsigned char*>(base), length);
+#endif // _WIN32
+        throw;
+    }
+}
+
+Corpus::~Corpus()
+{
+#ifndef _WIN32
+    munmap(const_cast<unsigned char*>(base), length);
+#endif // _WIN32
+}
+
+void Corpus::parse()
+{
+    if (length < HEADER_SIZE || !std::equal(MAGIC, MAGIC+4, base))
+    {
+        throw CorpusError("Not a corpus!");
+    }
+
+    const std::uint16_t version = peek<std::uint16_t>(base+4);
+    if (version < 1 || version > VERSION) throw CorpusError("Unsupported version!");
+
+    w       = peek<std::uint16_t>(base+6);
+    h       = peek<std::uint16_t>(base+8);
+    colors  = peek<std::uint16_t>(base+10);
+    minimum = peek<std::uint16_t>(base+12);
+
+    // Version 1 files predate configurable score zones.
+    zoneRows = (version >= 2)? peek<std::uint16_t>(base+48) : 2;
+    zoneCols = (version >= 2)? peek<std::uint16_t>(base+50) : 2;
+
+    recordSize = peek<std::uint32_t>(base+16);
+    games      = peek<std::uint32_t>(base+20);
+    records    = peek<std::uint64_t>(base+24);
+
+    const std::uint64_t recordsOffset = peek<std::uint64_t>(base+32);
+    const std::uint64_t indexOffset   = peek<std::uint64_t>(base+40);
+
+    if (recordSize != recordSizeFor(w, h)) throw CorpusError("Bad record size!");
+
+    try
+    {
+        rules().validate();
+    }
+    catch (const RulesError& e)
+    {
+        throw CorpusError(e.what());
+    }
+
+    if (recordsOffset + records*recordSize > length
+     || indexOffset + (games+1)*8 > length)
+    {
+        throw CorpusError("Truncated file!");
+    }
+
+    recordData = base+recordsOffset;
+    indexData  = base+indexOffset;
+}
+
+int Corpus::width() const
+{
+    return w;
+}
+
+int Corpus::height() const
+{
+    return h;
+}
+
+int Corpus::numColors() const
+{
+    return colors;
+}
+
+int Corpus::minScore() const
+{
+    return minimum;
+}
+
+Rules Corpus::rules() const
+{
+    Rules rval;
+    rval.width     = w;
+    rval.height    = h;
+    rval.numColors = colors;
+    rval.minScore  = minimum;
+    rval.zoneRows  = zoneRows;
+    rval.zoneCols  = zoneCols;
+    return rval;
+}
+
+std::size_t Corpus::size() const
+{
+    return records;
+}
+
+std::size_t Corpus::numGames() const
+{
+    return games;
+}
+
+Corpus::Record Corpus::operator[](std::size_t i) const
+{
+    return Record(*this, recordData+i*recordSize);
+}
+
+Corpus::Range Corpus::game(std::size_t g) const
+{
+    return Range(
+          peek<std::uint64_t>(indexData+g*8)
+        , peek<std::uint64_t>(indexData+g*8+8)
+    );
+}
+
+Corpus::Range Corpus::shard(int k, int n) const
+{
+    return Range(records*k/n, records*(k+1)/n);
+}
+
+/* CorpusWriter --                    --                      -- CorpusWriter */
+
+CorpusWriter::CorpusWriter(const std::string& filename, const Rules& rules)
+    : file(filename.c_str(), std::ios::binary)
+    , gameRules(rules)
+    , w(rules.width), h(rules.height)
+    , recordSize(recordSizeFor(w, h))
+    , records(0)
+    , index(1, 0)
+    , buffer(recordSize)
+{
+    if (!file) throw CorpusError("Can't open "+filename+"!");
+    if (rules.numColors > 15) throw CorpusError("Too many colors!");
+    writeHeader();
+}
+
+CorpusWriter::~CorpusWriter()
+{
+    if (file.is_open()) close();
+}
+
+void CorpusWriter::add(const std::uint8_t* board, CorpusMove mv)
+{
+    std::fill(buffer.begin(), buffer.end(), 0);
+
+    poke<std::uint32_t>(&buffer[0], index.size()-1);
+    poke<std::uint32_t>(&buffer[4], records-index.back());
+    buffer[8] = mv.kind;
+    poke<std::uint16_t>(&buffer[10], mv.a);
+    poke<std::uint16_t>(&buffer[12], mv.b);
+
+    for (int i=0; i<w*h; ++i)
+    {
+        buffer[BOARD_OFFSET+i/2] |= (board[i] & 0x0F) << (i%2*4);
+    }
+
+    file.write(reinterpret_cast<const char*>(&buffer[0]), recordSize);
+    ++records;
+}
+
+void CorpusWriter::endGame()
+{
+    if (records > index.back()) index.push_back(records);
+}
+
+void CorpusWriter::close()
+{
+    endGame();
+
+    for (std::uint64_t i : index)
+    {
+        unsigned char bytes[8];
+        poke(bytes, i);
+        file.write(reinterpret_cast<const char*>(bytes), 8);
+    }
+
+    file.seekp(0);
+    writeHeader();
+    file.close();
+}
+
+void CorpusWriter::writeHeader()
+{
+    unsigned char head[HEADER_SIZE] = {};
+
+    std::copy(MAGIC, MAGIC+4, head);
+    poke<std::uint16_t>(head+4,  VERSION);
+    poke<std::uint16_t>(head+6,  w);
+    poke<std::uint16_t>(head+8,  h);
+    poke<std::uint16_t>(head+10, gameRules.numColors);
+    poke<std::uint16_t>(head+12, gameRules.minScore);
+    poke<std::uint32_t>(head+16, recordSize);
+    poke<std::uint32_t>(head+20, index.size()-1);
+    poke<std::uint64_t>(head+24, records);
+    poke<std::uint64_t>(head+32, HEADER_SIZE);
+    poke<std::uint64_t>(head+40, HEADER_SIZE+records*recordSize);
+    poke<std::uint16_t>(head+48, gameRules.zoneRows);
+    poke<std::uint16_t>(head+50, gameRules.zoneCols);
+
+    file.write(reinterpret_cast<const char*>(head), HEADER_SIZE);
+}
@@ -0,0 +1,123 @@
+#ifndef CORPUS_HPP
+#define CORPUS_HPP
+
+#include "../rules.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Corpus files hold recorded positions as fixed-size records so that a reader
+// can map the file and walk it in place.
+//
+//   header  64 bytes
+//   records numRecords * recordSize bytes
+//   index   (numGames+1) first-record numbers, one per game plus an end mark
+//
+// A record is the game number, the move number within that game, the move
+// that was played there, and the board packed at four bits per cell.
+
+class CorpusError
+    : public std::runtime_error
+{
+public:
+    CorpusError(const std::string& what);
+};
+
+class CorpusMove
+{
+public:
+    enum Kind
+    {
+          SWAP
+        , SCORE
+    };
+
+    Kind kind;
+    int a;
+    int b;
+};
+
+class Corpus
+{
+public:
+    class Record
+    {
+    public:
+        Record(const Corpus& c, const unsigned char* p);
+
+        std::uint32_t game() const;
+        std::uint32_t move() const;
+        CorpusMove played() const;
+        int cellAt(int r, int c) const;
+
+    private:
+        const Corpus* corpus;
+        const unsigned char* data;
+    };
+
+    typedef std::pair<std::size_t, std::size_t> Range;
+
+    explicit Corpus(const std::string& filename);
+    ~Corpus();
+
+    Corpus(const Corpus&) = delete;
+    Corpus& operator=(const Corpus&) = delete;
+
+    int width() const;
+    int height() const;
+    int numColors() const;
+    int minScore() const;
+    Rules rules() const;
+
+    std::size_t size() const;
+    std::size_t numGames() const;
+
+    Record operator[](std::size_t i) const;
+
+    Range game(std::size_t g) const;
+    Range shard(int k, int n) const;
+
+private:
+    const unsigned char* base;
+    std::size_t length;
+    std::vector<unsigned char> fallback;
+
+    int w, h, colors, minimum;
+    int zoneRows, zoneCols;
+    std::size_t recordSize;
+    std::size_t records;
+    std::size_t games;
+    const unsigned char* recordData;
+    const unsigned char* indexData;
+
+    void parse();
+};
+
+class CorpusWriter
+{
+public:
+    CorpusWriter(const std::string& filename, const Rules& rules);
+    ~CorpusWriter();
+
+    void add(const std::uint8_t* board, CorpusMove mv);
+    void endGame();
+    void close();
+
+private:
+    std::ofstream file;
+    Rules gameRules;
+    int w, h;
+    std::size_t recordSize;
+    std::uint64_t records;
+    std::vector<std::uint64_t> index;
+    std::vector<unsigned char> buffer;
+
+    void writeHeader();
+};
+
+#endif // CORPUS_HPP
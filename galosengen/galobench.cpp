@@ -0,0 +1,86 @@
+#include "corpus.hpp"
+#include "galosengen.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+static string moveStr(const CorpusMove& mv, int width)
+{
+    stringstream ss;
+    if (mv.kind == CorpusMove::SWAP)
+    {
+        ss << "SWAP " << mv.a/width << " " << mv.a%width
+           << " "     << mv.b/width << " " << mv.b%width;
+    }
+    else
+    {
+        ss << "SCORE " << mv.a/width << " " << mv.a%width;
+    }
+    return ss.str();
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2 || argc > 3) return -1;
+
+    const Corpus corpus(argv[1]);
+    const int threads = (argc == 3)? atoi(argv[2]) : thread::hardware_concurrency();
+
+    if (threads < 1) return -2;
+
+    const string conv = ".pbygrcvk";
+    const string colors = conv.substr(1, corpus.numColors());
+
+    vector<int> matches(threads, 0);
+    vector<thread> workers;
+
+    auto start = chrono::steady_clock::now();
+
+    for (int k=0; k<threads; ++k)
+    {
+        workers.emplace_back([&, k]
+        {
+            GaloSengen gs(corpus.rules(), colors);
+
+            vector<string> bored(corpus.height(), string(corpus.width(), '.'));
+
+            Corpus::Range range = corpus.shard(k, threads);
+
+            for (size_t i=range.first; i<range.second; ++i)
+            {
+                const Corpus::Record rec = corpus[i];
+
+                for (int r=0; r<corpus.height(); ++r)
+                {
+                    for (int c=0; c<corpus.width(); ++c)
+                    {
+                        bored[r][c] = conv[rec.cellAt(r, c)];
+                    }
+                }
+
+                if (gs.play(bored)->str() == moveStr(rec.played(), corpus.width()))
+                {
+                    ++matches[k];
+                }
+            }
+        });
+    }
+
+    int same = 0;
+    for (int k=0; k<threads; ++k)
+    {
+        workers[k].join();
+        same += matches[k];
+    }
+
+    double secs = chrono::duration<double>(chrono::steady_clock::now()-start).count();
+
+    cout << corpus.size() << " " << same << " " << secs << " " << corpus.size()/secs << endl;
+}
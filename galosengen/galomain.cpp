@@ -9,16 +9,39 @@ using namespace std;
 
 int main(int argc, char* argv[])
 {
-    const unsigned height   = atoi(argv[1]);
-    const unsigned width    = atoi(argv[2]);
-    const unsigned minScore = atoi(argv[3]);
-    const string   colors   =      argv[4] ;
+    Rules rules;
+    string colors;
 
-    GaloSengen gs(width, height, minScore, colors);
+    try
+    {
+        rules = Rules::fromFile("rules.txt");
+
+        if (argc > 4)
+        {
+            rules.height    = atoi(argv[1]);
+            rules.width     = atoi(argv[2]);
+            rules.minScore  = atoi(argv[3]);
+            colors          =      argv[4] ;
+            rules.numColors = colors.size();
+        }
+        else
+        {
+            colors = string("pbygrcv").substr(0, rules.numColors);
+        }
+
+        rules.validate();
+    }
+    catch (const RulesError& e)
+    {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    GaloSengen gs(rules, colors);
 
     vector<string> bored;
 
-    for (unsigned i=0; i<height; ++i)
+    for (int i=0; i<rules.height; ++i)
     {
         string line;
         getline(cin, line);
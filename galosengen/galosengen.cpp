@@ -62,10 +62,10 @@ static bool comp(T1 a1, T2 a2, T3 a3, T1 b1, T2 b2, T3 b3)
     return false;
 }
 
-GaloSengen::GaloSengen(int w, int h, int ms, Array c)
-    : width(w)
-    , height(h)
-    , minScore(std::max(ms,3))
+GaloSengen::GaloSengen(const Rules& rules, Array c)
+    : width(rules.width)
+    , height(rules.height)
+    , minScore(std::max(rules.minScore,3))
     , colors(c)
     , colorVals()
     , scoreZone()
@@ -79,28 +79,29 @@ GaloSengen::GaloSengen(int w, int h, int ms, Array c)
         colorVals[c[i]] = i+2;
     }
 
-    for (int r=2; r<height-2; ++r)
-    {
-        for (int c=0; c<2; ++c)           scoreZone.push_back(Loc(r, c));
-        for (int c=width-2; c<width; ++c) scoreZone.push_back(Loc(r, c));
-    }
-
-    for (int r=2; r<height-2; ++r)
+    for (int r=0; r<height; ++r)
     {
-        extendedZone.push_back(Loc(r, 2));
-        extendedZone.push_back(Loc(r, width-3));
+        for (int c=0; c<width; ++c)
+        {
+            if (rules.isScoreTile(r, c)) scoreZone.push_back(Loc(r, c));
+        }
     }
 
-    for (int c=0; c<2; ++c)
+    // The extended zone is every cell bordering the score zone.
+    for (int r=0; r<height; ++r)
     {
-        extendedZone.push_back(Loc(1, c));
-        extendedZone.push_back(Loc(height-2, c));
-    }
+        for (int c=0; c<width; ++c)
+        {
+            if (rules.isScoreTile(r, c)) continue;
 
-    for (int c=width-2; c<width; ++c)
-    {
-        extendedZone.push_back(Loc(1, c));
-        extendedZone.push_back(Loc(height-2, c));
+            if ((r>0        && rules.isScoreTile(r-1, c))
+            ||  (r<height-1 && rules.isScoreTile(r+1, c))
+            ||  (c>0        && rules.isScoreTile(r, c-1))
+            ||  (c<width-1  && rules.isScoreTile(r, c+1)))
+            {
+                extendedZone.push_back(Loc(r, c));
+            }
+        }
     }
 
     //loadAI(normalAI, "galo-normal.txt");
@@ -197,7 +198,8 @@ void GaloSengen::loadAI(AISpec& ai, const char* filename)
 Ptr<Action> GaloSengen::play(Board board)
 {
 #ifdef INU_PROFILE
-    ScopedProfile _sp(profiler, "play()");
+    static const Profiler::Zone zone ("play()");
+    ScopedProfile _sp(profiler, zone);
 #endif // INU_PROFILE
 
     clean(board);
@@ -214,7 +216,8 @@ Ptr<Action> GaloSengen::play(Board board)
 
     {
 #ifdef INU_PROFILE
-        ScopedProfile _sp(profiler, "Swap AI");
+        static const Profiler::Zone zone ("Swap AI");
+        ScopedProfile _sp(profiler, zone);
 #endif // INU_PROFILE
 
         std::vector<Loc> locs;
@@ -237,7 +240,8 @@ Ptr<Action> GaloSengen::play(Board board)
 
         {
 #ifdef INU_PROFILE
-            ScopedProfile _sp(profiler, "Best Swap");
+            static const Profiler::Zone zone ("Best Swap");
+            ScopedProfile _sp(profiler, zone);
 #endif // INU_PROFILE
 
             for (unsigned i=0; i<locs.size()-1; ++i)
@@ -249,7 +253,8 @@ Ptr<Action> GaloSengen::play(Board board)
                     if (cellA == cellB) continue;
 
 #ifdef INU_PROFILE
-                    ScopedProfile _sp(profiler, "Test Swap");
+                    static const Profiler::Zone zone ("Test Swap");
+                    ScopedProfile _sp(profiler, zone);
 #endif // INU_PROFILE
 
                     std::swap(cellA, cellB);
@@ -346,7 +351,8 @@ int GaloSengen::fillGroups(const Board& board, LocGroup& groups) const
 int GaloSengen::weakGroups(const Board& board) const
 {
 #ifdef INU_PROFILE
-    ScopedProfile _sp(profiler, "weakGroups()");
+    static const Profiler::Zone zone ("weakGroups()");
+    ScopedProfile _sp(profiler, zone);
 #endif // INU_PROFILE
 
     class Iter
@@ -399,7 +405,8 @@ int GaloSengen::weakGroups(const Board& board) const
 Ptr<GaloSengen::BoardInfo> GaloSengen::getInfo(const Board& board)
 {
 #ifdef INU_PROFILE
-    ScopedProfile _sp(profiler, "getInfo");
+    static const Profiler::Zone zone ("getInfo");
+    ScopedProfile _sp(profiler, zone);
 #endif // INU_PROFILE
 
     typedef std::set<LocGroup::Group> SG;
@@ -420,8 +427,17 @@ Ptr<GaloSengen::BoardInfo> GaloSengen::getInfo(const Board& board)
 
     {
 #ifdef INU_PROFILE
-        ScopedProfile _sp(profiler, "Group Sizes");
+        static const Profiler::Zone zone ("Group Sizes");
+        ScopedProfile _sp(profiler, zone);
+#endif // INU_PROFILE
+
+        {
+#ifdef INU_PROFILE
+            static const Profiler::Zone zone ("Get Sizes");
+            ScopedProfile _sp(profiler, zone);
 #endif // INU_PROFILE
+            grp2gsz = *rval->groups.getSizes();
+        }
 
         std::set<LocGroup::Group> grps;
         for (unsigned r=0; r<height; ++r)
@@ -429,33 +445,10 @@ Ptr<GaloSengen::BoardInfo> GaloSengen::getInfo(const Board& board)
             for (unsigned c=0; c<width; ++c)
             {
                 if (board[r][c] == EMPTY) continue;
-                LocGroup::Group p;
                 const Loc l (r, c);
-                {
-#ifdef INU_PROFILE
-                    ScopedProfile _sp(profiler, "Get Group");
-#endif // INU_PROFILE
-                    p = rval->groups.getGroup(l);
-                    loc2grp[l] = p;
-                }
-                int sz;
-                std::map<LocGroup::Group, int>::iterator szi;
-                {
-#ifdef INU_PROFILE
-                    ScopedProfile _sp(profiler, "Get Size");
-#endif // INU_PROFILE
-                    szi = grp2gsz.find(p);
-                    if (szi == grp2gsz.end())
-                    {
-                        sz = rval->groups.getSize(p);
-                        grp2gsz.insert(szi, std::make_pair(p, sz));
-                    }
-                    else
-                    {
-                        sz = szi->second;
-                    }
-                }
-                if (sz < 5) grps.insert(p);
+                LocGroup::Group p = rval->groups.getGroup(l);
+                loc2grp[l] = p;
+                if (grp2gsz[p] < 5) grps.insert(p);
             }
         }
         rval->numSmallGroups = grps.size();
@@ -468,7 +461,8 @@ Ptr<GaloSengen::BoardInfo> GaloSengen::getInfo(const Board& board)
 
     {
 #ifdef INU_PROFILE
-        ScopedProfile _sp(profiler, "Score Zone Groups");
+        static const Profiler::Zone zone ("Score Zone Groups");
+        ScopedProfile _sp(profiler, zone);
 #endif // INU_PROFILE
 
         for (ZoneIter i=scoreZone.begin(); i!=scoreZone.end(); ++i)
@@ -8,6 +8,8 @@
 
 #include "utils.inl"
 
+#include "../rules.hpp"
+
 #include <map>
 #include <sstream>
 #include <string>
@@ -63,7 +65,7 @@ public:
 
     SpecSet inverseSpecs;
 
-    GaloSengen(int w, int h, int ms, Array c);
+    GaloSengen(const Rules& rules, Array c);
     void loadAI(AISpec& ai, const char* filename);
     Ptr<Action> play(Board board);
 
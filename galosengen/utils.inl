@@ -69,9 +69,10 @@ public:
 
     Ptr& operator=(const Ptr& in)
     {
+        if (in.data) ++in.data->refs;
         del();
         data = in.data;
-        if (data) ++data->refs;
+        return *this;
     }
 
     void del()
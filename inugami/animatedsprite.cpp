@@ -79,16 +79,17 @@ void AnimatedSprite::setSequence(FrameList in)
     timer = sequence[0].second;
 }
 
-void AnimatedSprite::draw(Core& core, Transform in) const
+void AnimatedSprite::draw(Core& core, const Transform& in) const
 {
     if (sequence.empty()) throw std::logic_error("Animation is empty!");
 
     if (ended) return;
 
     auto& sprite = sprites[sequence[pos].first];
-    in.scale(Vec3{(flipX)?-1.f:1.f, (flipY)?-1.f:1.f, 1.f});
-    in.rotate(rot, Vec3{0.f, 0.f, 1.f});
-    core.modelMatrix(in);
+    Transform mat = in;
+    mat.scale(Vec3{(flipX)?-1.f:1.f, (flipY)?-1.f:1.f, 1.f});
+    mat.rotate(rot, Vec3{0.f, 0.f, 1.f});
+    core.modelMatrix(mat);
     sheet.draw(sprite.first, sprite.second);
 }
 
@@ -133,7 +133,7 @@ public:
      *  @param core The @ref Core to use for drawing.
      *  @param in The @ref Transform to use as the origin.
      */
-    void draw(Core& core, Transform in) const;
+    void draw(Core& core, const Transform& in) const;
 
     /*! @brief Advances the sprite's frame.
      *
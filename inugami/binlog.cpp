@@ -0,0 +1,271 @@
+/*******************************************************************************
+ * Inugami - An OpenGL framework designed for rapid game development
+ * Version: 0.2.0
+ * https://github.com/DBRalir/Inugami
+ *
+ * Copyright (c) 2012 Jeramy Harrison <dbralir@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#include "binlog.hpp"
+
+#include <iomanip>
+#include <mutex>
+
+namespace Inugami {
+
+namespace {
+
+struct FormatRegistry
+{
+    std::mutex mutex;
+    std::vector<const LogFormat*> formats;
+
+    FormatRegistry()
+        : mutex()
+        , formats()
+    {}
+};
+
+FormatRegistry& formatRegistry()
+{
+    static FormatRegistry reg;
+    return reg;
+}
+
+std::uint32_t registerFormat(const LogFormat* fmt)
+{
+    auto& reg = formatRegistry();
+    std::lock_guard<std::mutex> lock (reg.mutex);
+    reg.formats.push_back(fmt);
+    return reg.formats.size()-1;
+}
+
+// Reads fields out of a record body
+class Reader
+{
+public:
+    Reader(const std::string& b)
+        : body(b)
+        , pos(0)
+    {}
+
+    template <typename T>
+    T raw()
+    {
+        T rval;
+        need(sizeof(T));
+        std::memcpy(&rval, body.data()+pos, sizeof(T));
+        pos += sizeof(T);
+        return rval;
+    }
+
+    std::string string()
+    {
+        auto n = raw<std::uint16_t>();
+        need(n);
+        std::string rval = body.substr(pos, n);
+        pos += n;
+        return rval;
+    }
+
+    bool done() const
+    {
+        return pos >= body.size();
+    }
+
+private:
+    void need(std::size_t n)
+    {
+        if (pos+n > body.size()) throw BinLogException("Record too short!");
+    }
+
+    const std::string& body;
+    std::size_t pos;
+};
+
+struct Format
+{
+    std::string format;
+    std::string file;
+    std::uint32_t line;
+
+    Format()
+        : format()
+        , file()
+        , line(0)
+    {}
+};
+
+} // namespace
+
+BinLogException::BinLogException(const std::string& what)
+    : err("BinLog Exception: "+what)
+{}
+
+const char* BinLogException::what() const noexcept
+{
+    return err.c_str();
+}
+
+LogFormat::LogFormat(const char* fmt, const char* f, int l)
+    : format(fmt)
+    , file(f)
+    , line(l)
+    , id(registerFormat(this))
+{}
+
+const LogFormat* LogFormat::find(std::uint32_t id) //static
+{
+    auto& reg = formatRegistry();
+    std::lock_guard<std::mutex> lock (reg.mutex);
+    return (id < reg.formats.size())? reg.formats[id] : nullptr;
+}
+
+namespace BinLog {
+
+std::uint32_t lineFormat(const Record& rec)
+{
+    std::uint32_t id;
+    std::memcpy(&id, rec.bytes+3, sizeof(id));
+    return id;
+}
+
+void writeFormat(std::ostream& out, const LogFormat& fmt)
+{
+    const std::string file = std::string(fmt.file).substr(0, 1024);
+    const std::string format = std::string(fmt.format).substr(0, 16384);
+
+    auto put = [&](const void* data, std::size_t n){ out.write(static_cast<const char*>(data), n); };
+
+    const char tag = FORMAT;
+    const std::uint16_t body = 4+4+2+file.size()+2+format.size();
+    const std::uint32_t line = fmt.line;
+    const std::uint16_t fileSize = file.size();
+    const std::uint16_t formatSize = format.size();
+
+    put(&tag, 1);
+    put(&body, 2);
+    put(&fmt.id, 4);
+    put(&line, 4);
+    put(&fileSize, 2);
+    put(file.data(), file.size());
+    put(&formatSize, 2);
+    put(format.data(), format.size());
+}
+
+std::string expand(const char* format, const std::vector<std::string>& args)
+{
+    std::string rval;
+    unsigned next = 0;
+
+    for (const char* c = format; *c; ++c)
+    {
+        if (c[0] == '{' && c[1] == '}' && next < args.size())
+        {
+            rval += args[next++];
+            ++c;
+        }
+        else rval += *c;
+    }
+
+    for (; next < args.size(); ++next) rval += " " + args[next];
+
+    return rval;
+}
+
+void decode(std::istream& in, std::ostream& out)
+{
+    char magic[sizeof(MAGIC)-1];
+    if (!in.read(magic, sizeof(magic)) || std::string(magic, sizeof(magic)) != MAGIC)
+    {
+        throw BinLogException("Not a binary log!");
+    }
+
+    std::vector<Format> formats;
+
+    char tag;
+    while (in.get(tag))
+    {
+        std::uint16_t size;
+        std::string body;
+        if (!in.read(reinterpret_cast<char*>(&size), sizeof(size))) throw BinLogException("Truncated record!");
+        body.resize(size);
+        if (size > 0 && !in.read(&body[0], size)) throw BinLogException("Truncated record!");
+
+        Reader r (body);
+
+        if (tag == FORMAT)
+        {
+            auto id = r.raw<std::uint32_t>();
+            Format f;
+            f.line = r.raw<std::uint32_t>();
+            f.file = r.string();
+            f.format = r.string();
+            if (id >= formats.size()) formats.resize(id+1);
+            formats[id] = f;
+        }
+        else if (tag == LINE)
+        {
+            auto id = r.raw<std::uint32_t>();
+            auto priority = r.raw<std::uint8_t>();
+            auto nanos = r.raw<std::uint64_t>();
+            auto flags = r.raw<std::uint8_t>();
+
+            // The prefix is stored like a string argument
+            r.raw<char>();
+            std::string prefix = r.string();
+
+            std::vector<std::string> args;
+            while (!r.done())
+            {
+                std::ostringstream ss;
+                switch (r.raw<char>())
+                {
+                    case 'i': ss << r.raw<std::int64_t>(); break;
+                    case 'u': ss << r.raw<std::uint64_t>(); break;
+                    case 'd': ss << r.raw<double>(); break;
+                    case 'b': ss << (r.raw<std::uint8_t>()? "true" : "false"); break;
+                    case 'c': ss << r.raw<char>(); break;
+                    case 's': ss << r.string(); break;
+                    default: throw BinLogException("Unknown argument type!");
+                }
+                args.push_back(ss.str());
+            }
+
+            if (id >= formats.size() || formats[id].format.empty())
+            {
+                throw BinLogException("Line uses unknown format "+std::to_string(id)+"!");
+            }
+
+            out << "[" << int(priority) << "] "
+                << std::fixed << std::setprecision(6) << nanos/1e9 << " "
+                << prefix << expand(formats[id].format.c_str(), args);
+            if (flags & TRUNCATED) out << " (truncated)";
+            out << "\n";
+        }
+        else throw BinLogException("Unknown record!");
+    }
+}
+
+} // namespace BinLog
+
+} // namespace Inugami
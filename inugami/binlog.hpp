@@ -0,0 +1,377 @@
+/*******************************************************************************
+ * Inugami - An OpenGL framework designed for rapid game development
+ * Version: 0.2.0
+ * https://github.com/DBRalir/Inugami
+ *
+ * Copyright (c) 2012 Jeramy Harrison <dbralir@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#ifndef INUGAMI_BINLOG_H
+#define INUGAMI_BINLOG_H
+
+#include "exception.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/*! @brief Logs a line through a format that is only expanded when decoded.
+ *
+ *  Each use of this macro registers its format once. When the Logger writes
+ *  a binary log, only the format ID and the raw arguments are recorded, and
+ *  BinLog::decode() does the formatting later. Otherwise the line is
+ *  formatted immediately, like Logger::log().
+ *
+ *  Every "{}" in the format is replaced by the next argument.
+ *
+ *  @code
+ *  INU_LOG(logger, 1, "Row {} is {}", r, row);
+ *  @endcode
+ *
+ *  @param LOG Pointer to a Logger.
+ *  @param PRIORITY Priority of the line.
+ *  @param FORMAT String literal with a "{}" per argument.
+ */
+#define INU_LOG(LOG, PRIORITY, FORMAT, ...) \
+    do \
+    { \
+        static const ::Inugami::LogFormat inuLogFormat (FORMAT, __FILE__, __LINE__); \
+        (LOG)->template logFormat<PRIORITY>(inuLogFormat, ##__VA_ARGS__); \
+    } while (false)
+
+namespace Inugami {
+
+class BinLogException
+    : public Exception
+{
+public:
+    BinLogException(const std::string& what);
+    virtual const char* what() const noexcept override;
+    std::string err;
+};
+
+/*! @brief Registered format of a binary log line.
+ *
+ *  Usually created by INU_LOG().
+ */
+class LogFormat
+{
+public:
+    /*! @brief Primary constructor.
+     *
+     *  Assigns the next ID. The strings must outlive the LogFormat.
+     */
+    LogFormat(const char* format, const char* file, int line);
+
+    LogFormat(const LogFormat&) = delete;
+    LogFormat& operator=(const LogFormat&) = delete;
+
+    /*! @brief Finds a LogFormat by ID.
+     *
+     *  @return The LogFormat, or @a nullptr if there is none.
+     */
+    static const LogFormat* find(std::uint32_t id);
+
+    const char* const format; //!< Format string.
+    const char* const file;   //!< Source file.
+    const int line;           //!< Source line.
+    const std::uint32_t id;   //!< Index of this LogFormat.
+};
+
+namespace BinLog {
+
+/*! @brief First bytes of a binary log.
+ */
+constexpr char MAGIC[] = "INUBLOG1";
+
+/*! @brief Record kinds.
+ *
+ *  Every record is a tag, a 16-bit body size, and the body. Numbers are in
+ *  the byte order of the machine that wrote the log.
+ */
+enum Tag : char
+{
+      FORMAT = 'F' //!< ID, line, file, and format of a LogFormat.
+    , LINE   = 'L' //!< ID, priority, nanoseconds, flags, prefix, arguments.
+};
+
+/*! @brief Record flags.
+ */
+enum Flag : std::uint8_t
+{
+    TRUNCATED = 1 //!< Arguments did not fit in the Record.
+};
+
+/*! @brief One encoded line, sized to be copied in one go.
+ */
+struct Record
+{
+    static constexpr std::size_t CAPACITY = 254;
+
+    std::uint16_t size;
+    char bytes[CAPACITY];
+};
+
+/*! @brief Appends fields to a Record.
+ *
+ *  Anything that doesn't fit is dropped whole, and the Record is marked
+ *  truncated.
+ */
+class Encoder
+{
+public:
+    explicit Encoder(Record& r)
+        : rec(r)
+        , full(false)
+    {
+        rec.size = 0;
+    }
+
+    template <typename T>
+    void raw(const T& v)
+    {
+        bytes(&v, sizeof(T));
+    }
+
+    void bytes(const void* data, std::size_t n)
+    {
+        if (full || rec.size+n > Record::CAPACITY)
+        {
+            full = true;
+            return;
+        }
+        std::memcpy(rec.bytes+rec.size, data, n);
+        rec.size += n;
+    }
+
+    template <typename T>
+    void field(char tag, const T& v)
+    {
+        // The tag is only written if its value fits too
+        if (!reserve(1+sizeof(T))) return;
+        raw(tag);
+        raw(v);
+    }
+
+    void string(const char* str, std::size_t n)
+    {
+        // Long strings are cut to fit rather than dropped
+        if (!reserve(3)) return;
+        std::size_t room = Record::CAPACITY-rec.size-3;
+        bool cut = (n > room);
+        if (cut) n = room;
+        raw('s');
+        raw(std::uint16_t(n));
+        bytes(str, n);
+        if (cut) full = true;
+    }
+
+    bool truncated() const
+    {
+        return full;
+    }
+
+    Record& rec;
+
+private:
+    bool reserve(std::size_t n)
+    {
+        if (full || rec.size+n > Record::CAPACITY) full = true;
+        return !full;
+    }
+
+    bool full;
+};
+
+/*! @brief Writes one argument.
+ *
+ *  Anything without a specialization is formatted with operator<< at the
+ *  call site.
+ */
+template <typename T, typename Enable = void>
+struct Arg
+{
+    static void write(Encoder& e, const T& v)
+    {
+        std::ostringstream ss;
+        ss << v;
+        const std::string str = ss.str();
+        e.string(str.data(), str.size());
+    }
+};
+
+template <typename T>
+struct Arg<T, typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type>
+{
+    static void write(Encoder& e, T v)
+    {
+        e.field('i', std::int64_t(v));
+    }
+};
+
+template <typename T>
+struct Arg<T, typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value>::type>
+{
+    static void write(Encoder& e, T v)
+    {
+        e.field('u', std::uint64_t(v));
+    }
+};
+
+template <typename T>
+struct Arg<T, typename std::enable_if<std::is_floating_point<T>::value>::type>
+{
+    static void write(Encoder& e, T v)
+    {
+        e.field('d', double(v));
+    }
+};
+
+template <>
+struct Arg<bool>
+{
+    static void write(Encoder& e, bool v)
+    {
+        e.field('b', std::uint8_t(v));
+    }
+};
+
+template <>
+struct Arg<char>
+{
+    static void write(Encoder& e, char v)
+    {
+        e.field('c', v);
+    }
+};
+
+template <>
+struct Arg<std::string>
+{
+    static void write(Encoder& e, const std::string& v)
+    {
+        e.string(v.data(), v.size());
+    }
+};
+
+template <>
+struct Arg<const char*>
+{
+    static void write(Encoder& e, const char* v)
+    {
+        e.string(v, std::strlen(v));
+    }
+};
+
+template <>
+struct Arg<char*>
+    : Arg<const char*>
+{};
+
+template <std::size_t N>
+struct Arg<char[N]>
+    : Arg<const char*>
+{};
+
+inline void writeArgs(Encoder&)
+{}
+
+template <typename T, typename... VT>
+void writeArgs(Encoder& e, const T& a, const VT&... args)
+{
+    Arg<T>::write(e, a);
+    writeArgs(e, args...);
+}
+
+/*! @brief Encodes a LINE record.
+ */
+template <typename... T>
+void encodeLine(Record& rec, const LogFormat& fmt, unsigned priority, std::uint64_t nanos, const std::string& prefix, const T&... args)
+{
+    Encoder e (rec);
+    e.raw(char(LINE));
+    e.raw(std::uint16_t(0));
+    e.raw(fmt.id);
+    e.raw(std::uint8_t(priority));
+    e.raw(nanos);
+    e.raw(std::uint8_t(0));
+    e.string(prefix.data(), std::min<std::size_t>(prefix.size(), 64));
+    writeArgs(e, args...);
+
+    std::uint8_t flags = (e.truncated())? TRUNCATED : 0;
+    std::memcpy(rec.bytes+16, &flags, 1);
+
+    std::uint16_t body = rec.size-3;
+    std::memcpy(rec.bytes+1, &body, 2);
+}
+
+/*! @brief Reads the format ID of an encoded LINE record.
+ */
+std::uint32_t lineFormat(const Record& rec);
+
+/*! @brief Writes a FORMAT record.
+ */
+void writeFormat(std::ostream& out, const LogFormat& fmt);
+
+/*! @brief Replaces each "{}" in a format with the next argument.
+ *
+ *  Leftover arguments are appended, separated by spaces.
+ */
+std::string expand(const char* format, const std::vector<std::string>& args);
+
+template <typename T>
+std::string toString(const T& v)
+{
+    std::ostringstream ss;
+    ss << v;
+    return ss.str();
+}
+
+/*! @brief Formats a line immediately.
+ */
+template <typename... T>
+std::string expandNow(const LogFormat& fmt, const T&... args)
+{
+    return expand(fmt.format, {toString(args)...});
+}
+
+/*! @brief Decodes a binary log into text.
+ *
+ *  @param in Binary log.
+ *  @param out Stream to write one line of text per logged line to.
+ *
+ *  @throws BinLogException if the log is malformed.
+ */
+void decode(std::istream& in, std::ostream& out);
+
+} // namespace BinLog
+
+} // namespace Inugami
+
+#endif // INUGAMI_BINLOG_H
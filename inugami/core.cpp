@@ -29,6 +29,7 @@
 
 #include "camera.hpp"
 #include "exception.hpp"
+#include "image.hpp"
 #include "interface.hpp"
 #include "loaders.hpp"
 #include "shaderprogram.hpp"
@@ -36,6 +37,12 @@
 #include <iomanip>
 #include <ostream>
 #include <sstream>
+#include <thread>
+
+#ifdef INU_HEADLESS
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif // INU_HEADLESS
 
 namespace Inugami {
 
@@ -69,6 +76,7 @@ Core::RenderParams::RenderParams()
     , fullscreen(false)
     , vsync(false)
     , fsaaSamples(0)
+    , headless(false)
 {}
 
 Core::Core(const RenderParams &params)
@@ -76,8 +84,12 @@ Core::Core(const RenderParams &params)
     , iface(nullptr)
 
     , callbacks()
+    , update{nullptr, 0.0, Clock::time_point()}
+    , updateError()
+    , overrunHandler()
+    , overruns(0)
 
-    , frameStartTime(0.f)
+    , frameStartTime(Clock::now())
     , frameRateStack(10, 0.0)
     , frStackIterator(frameRateStack.begin())
 
@@ -87,37 +99,88 @@ Core::Core(const RenderParams &params)
     , windowTitle("Inugami")
     , windowTitleShowFPS(false)
     , window(nullptr)
+    , offscreen{nullptr, nullptr, 0, 0, 0}
+    , capture{false, "", 0}
+    , frameTimes()
 
     , viewProjection(1.f)
 
     , shader()
+
+    , uniformIDs{{}, {}, {}, {}}
+
+    , cameraBuffer(0)
+    , cameraBlock(false)
 {
-    if (numCores == 0) glfwInit();
+    if (rparams.headless)
+    {
+        openOffscreen();
+    }
+    else
+    {
+        glfwInit();
 
-    glfwWindowHint(GLFW_SAMPLES, rparams.fsaaSamples);
+        glfwWindowHint(GLFW_SAMPLES, rparams.fsaaSamples);
 
-    window = glfwCreateWindow(
-          rparams.width
-        , rparams.height
-        , windowTitle.c_str()
-        , (rparams.fullscreen)? nullptr : nullptr //! @todo detect monitors
-        , nullptr
-    );
+        window = glfwCreateWindow(
+              rparams.width
+            , rparams.height
+            , windowTitle.c_str()
+            , (rparams.fullscreen)? nullptr : nullptr //! @todo detect monitors
+            , nullptr
+        );
 
-    if (!window)
-    {
-        throw CoreException(this, "Failed to open window.");
+        if (!window)
+        {
+            throw CoreException(this, "Failed to open window.");
+        }
     }
 
     activate();
 
-    if (numCores == 0 && glewInit() != GLEW_OK)
+    if (numCores == 0)
     {
-        throw CoreException(this, "Failed to initialize GLEW.");
+        GLenum err = glewInit();
+
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+        // The entry points are loaded even when there is no X display
+        if (!window && err == GLEW_ERROR_NO_GLX_DISPLAY) err = GLEW_OK;
+#endif
+
+        if (err != GLEW_OK)
+        {
+            throw CoreException(this, "Failed to initialize GLEW.");
+        }
     }
 
-    if (rparams.vsync) glfwSwapInterval(1);
-    else glfwSwapInterval(0);
+    if (window)
+    {
+        if (rparams.vsync) glfwSwapInterval(1);
+        else glfwSwapInterval(0);
+    }
+    else
+    {
+        glGenFramebuffers(1, &offscreen.framebuffer);
+        glGenRenderbuffers(1, &offscreen.color);
+        glGenRenderbuffers(1, &offscreen.depth);
+
+        glBindRenderbuffer(GL_RENDERBUFFER, offscreen.color);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, rparams.width, rparams.height);
+        glBindRenderbuffer(GL_RENDERBUFFER, offscreen.depth);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, rparams.width, rparams.height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, offscreen.framebuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, offscreen.color);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, offscreen.depth);
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        {
+            throw CoreException(this, "Failed to create offscreen framebuffer.");
+        }
+
+        glViewport(0, 0, rparams.width, rparams.height);
+    }
 
     glEnable(GL_TEXTURE_2D);
     glShadeModel(GL_FLAT);
@@ -141,6 +204,15 @@ Core::Core(const RenderParams &params)
 
     shader = Shader(ShaderProgram::fromDefault());
 
+#ifndef INU_NO_SHADERS
+    glGenBuffers(1, &cameraBuffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, cameraBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(Mat4)*3, nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, 0, cameraBuffer);
+#endif // INU_NO_SHADERS
+
+    initUniformIDs();
+
     iface = std::unique_ptr<Interface>(new Interface(window)); //! @todo make_unique
 
     ++numCores;
@@ -150,7 +222,21 @@ Core::~Core()
 {
     activate();
 
-    glfwDestroyWindow(window);
+#ifndef INU_NO_SHADERS
+    glDeleteBuffers(1, &cameraBuffer);
+#endif // INU_NO_SHADERS
+
+    if (window)
+    {
+        glfwDestroyWindow(window);
+    }
+    else
+    {
+        glDeleteFramebuffers(1, &offscreen.framebuffer);
+        glDeleteRenderbuffers(1, &offscreen.color);
+        glDeleteRenderbuffers(1, &offscreen.depth);
+        closeOffscreen();
+    }
 
     if (--numCores == 0)
     {
@@ -160,12 +246,89 @@ Core::~Core()
 
 void Core::activate() const
 {
-    glfwMakeContextCurrent(window);
+    if (window)
+    {
+        glfwMakeContextCurrent(window);
+        return;
+    }
+
+#ifdef INU_HEADLESS
+    if (eglGetCurrentContext() != offscreen.context)
+    {
+        eglMakeCurrent(offscreen.display, EGL_NO_SURFACE, EGL_NO_SURFACE, offscreen.context);
+    }
+#endif // INU_HEADLESS
 }
 
 void Core::deactivate() const
 {
-    glfwMakeContextCurrent(nullptr);
+    if (window)
+    {
+        glfwMakeContextCurrent(nullptr);
+        return;
+    }
+
+#ifdef INU_HEADLESS
+    eglMakeCurrent(offscreen.display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+#endif // INU_HEADLESS
+}
+
+void Core::openOffscreen()
+{
+#ifdef INU_HEADLESS
+    auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+        eglGetProcAddress("eglGetPlatformDisplayEXT")
+    );
+
+    EGLDisplay display = EGL_NO_DISPLAY;
+
+    if (getPlatformDisplay)
+    {
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+
+    if (display == EGL_NO_DISPLAY)
+    {
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr))
+    {
+        throw CoreException(this, "Failed to open EGL display.");
+    }
+
+    offscreen.display = display;
+
+    if (!eglBindAPI(EGL_OPENGL_API))
+    {
+        throw CoreException(this, "EGL does not support OpenGL.");
+    }
+
+    const EGLint attribs[] = {
+          EGL_CONTEXT_MAJOR_VERSION, 3
+        , EGL_CONTEXT_MINOR_VERSION, 3
+        , EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT
+        , EGL_NONE
+    };
+
+    offscreen.context = eglCreateContext(display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attribs);
+
+    if (offscreen.context == EGL_NO_CONTEXT)
+    {
+        throw CoreException(this, "Failed to create EGL context.");
+    }
+#else
+    throw CoreException(this, "Headless mode requires INU_HEADLESS.");
+#endif // INU_HEADLESS
+}
+
+void Core::closeOffscreen()
+{
+#ifdef INU_HEADLESS
+    eglMakeCurrent(offscreen.display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(offscreen.display, offscreen.context);
+    eglTerminate(offscreen.display);
+#endif // INU_HEADLESS
 }
 
 void Core::beginFrame()
@@ -180,14 +343,14 @@ void Core::beginFrame()
         frStackIterator = begin(frameRateStack);
     }
 
-    frameStartTime = glfwGetTime();
+    frameStartTime = Clock::now();
 
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     getShader().bind();
 
     //Title
-    if (windowTitleShowFPS)
+    if (window && windowTitleShowFPS)
     {
         std::stringstream ss;
         ss << windowTitle << " (" << std::fixed << std::setprecision(2) << getAverageFrameRate() << " FPS)";
@@ -197,12 +360,51 @@ void Core::beginFrame()
 
 void Core::endFrame()
 {
-    glfwSwapBuffers(window);
+    if (capture.times)
+    {
+        glFinish();
+        frameTimes.push_back(std::chrono::duration<double>(Clock::now() - frameStartTime).count());
+    }
+
+    if (!capture.prefix.empty())
+    {
+        std::stringstream ss;
+        ss << capture.prefix << std::setfill('0') << std::setw(6) << capture.frame << ".png";
+        readFrame().toPNG(ss.str());
+    }
+
+    ++capture.frame;
+
+    if (window) glfwSwapBuffers(window);
+    else glFlush();
+}
+
+void Core::captureFrames(bool times, const std::string& pngPrefix)
+{
+    capture.times = times;
+    capture.prefix = pngPrefix;
+}
+
+const std::vector<double>& Core::getFrameTimes() const
+{
+    return frameTimes;
+}
+
+Image Core::readFrame() const
+{
+    activate();
+
+    Image rval(rparams.width, rparams.height);
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, rparams.width, rparams.height, GL_RGBA, GL_UNSIGNED_BYTE, &rval.pixelAt(0, 0)[0]);
+
+    return rval;
 }
 
 double Core::getInstantFrameRate() const
 {
-    return 1.0/(glfwGetTime() - frameStartTime);
+    return 1.0/std::chrono::duration<double>(Clock::now() - frameStartTime).count();
 }
 
 double Core::getAverageFrameRate() const
@@ -223,13 +425,20 @@ void Core::applyCam(const Camera& in)
     if (in.depthTest) glEnable (GL_DEPTH_TEST);
     else              glDisable(GL_DEPTH_TEST);
 
+    viewProjection = in.getProjection()*in.getView();
+
 #ifndef INU_NO_SHADERS
-    getShader().setUniform("projectionMatrix", in.getProjection());
-    getShader().setUniform("viewMatrix"      , in.getView()      );
-    getShader().setUniform("modelMatrix"     , glm::mat4(1.f)    );
-#endif // INU_NO_SHADERS
+    if (cameraBlock)
+    {
+        const Mat4 block[3] = {in.getProjection(), in.getView(), viewProjection};
+        glBindBuffer(GL_UNIFORM_BUFFER, cameraBuffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(block), &block[0][0][0]);
+    }
 
-    viewProjection = in.getProjection()*in.getView();
+    getShader().setUniform(uniformIDs.projectionMatrix, in.getProjection());
+    getShader().setUniform(uniformIDs.viewMatrix      , in.getView()      );
+    getShader().setUniform(uniformIDs.modelMatrix     , glm::mat4(1.f)    );
+#endif // INU_NO_SHADERS
 }
 
 void Core::modelMatrix(const Mat4& in)
@@ -237,8 +446,8 @@ void Core::modelMatrix(const Mat4& in)
     activate();
 
 #ifndef INU_NO_SHADERS
-    getShader().setUniform("modelMatrix", in               );
-    getShader().setUniform("MVP"        , viewProjection*in);
+    getShader().setUniform(uniformIDs.modelMatrix, in               );
+    getShader().setUniform(uniformIDs.MVP        , viewProjection*in);
 #else
     auto modelmat = viewProjection * in;
     glLoadMatrixf(&modelmat[0][0]);
@@ -249,7 +458,7 @@ void Core::setWindowTitle(const char *text, bool showFPS)
 {
     windowTitle = text;
     windowTitleShowFPS = showFPS;
-    glfwSetWindowTitle(window, text);
+    if (window) glfwSetWindowTitle(window, text);
 }
 
 const Core::RenderParams& Core::getParams() const
@@ -259,7 +468,7 @@ const Core::RenderParams& Core::getParams() const
 
 void Core::addCallback(std::function<void()> func, double freq)
 {
-    callbacks.push_back({func, freq, glfwGetTime()});
+    callbacks.push_back({func, freq, Clock::now()});
 }
 
 void Core::clearCallbacks()
@@ -267,35 +476,136 @@ void Core::clearCallbacks()
     callbacks.clear();
 }
 
+void Core::setUpdate(std::function<void()> func, double freq)
+{
+    update = {func, freq, Clock::now()};
+}
+
+void Core::setOverrunHandler(std::function<void(const Overrun&)> func)
+{
+    overrunHandler = func;
+}
+
+std::uint64_t Core::getOverruns() const
+{
+    return overruns;
+}
+
 void Core::go()
 {
+    using namespace std::chrono;
+
     running = true;
 
-    double currentTime = 0.0;
-    double deltaTime = 0.0;
+    std::thread updater;
+    if (update.func) updater = std::thread(&Core::updateLoop, this);
 
-    while (running)
+    // Without an update thread, nothing else needs to wake the loop
+    const auto idle = (updater.joinable())
+        ? duration_cast<Clock::duration>(duration<double>(1.0/update.freq))
+        : duration_cast<Clock::duration>(milliseconds(100));
+
+    try
     {
-        for (auto& cb : callbacks)
+        while (running)
         {
-            if (cb.freq < 0.0)
-            {
-                cb.func();
-                continue;
-            }
+            if (updater.joinable()) Interface::pump();
 
-            currentTime = glfwGetTime();
-            deltaTime = (currentTime - cb.last)*cb.freq;
+            auto wake = Clock::now() + idle;
 
-            if (deltaTime >= 1.0)
+            for (unsigned i=0; i<callbacks.size(); ++i)
             {
-                cb.last = currentTime;
-                cb.func();
+                auto& cb = callbacks[i];
+
+                if (cb.freq < 0.0)
+                {
+                    cb.func();
+                    wake = Clock::now();
+                    continue;
+                }
+
+                auto now = Clock::now();
+
+                if (now >= cb.next)
+                {
+                    cb.next += duration_cast<Clock::duration>(duration<double>(1.0/cb.freq));
+                    if (cb.next < now) cb.next = now;
+                    timedCall(cb.func, cb.freq, i);
+                }
+
+                if (cb.next < wake) wake = cb.next;
+
+                if (!running) break;
             }
 
-            if (!running) break;
+            std::this_thread::sleep_until(wake);
         }
     }
+    catch (...)
+    {
+        // The update thread must be joined before the exception unwinds it
+        running = false;
+        if (updater.joinable()) updater.join();
+        throw;
+    }
+
+    if (updater.joinable()) updater.join();
+
+    if (updateError)
+    {
+        auto error = updateError;
+        updateError = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+void Core::updateLoop()
+{
+    using namespace std::chrono;
+
+    // Ticks to run back-to-back before giving up on catching up
+    constexpr int maxCatchUp = 5;
+
+    const auto period = duration_cast<Clock::duration>(duration<double>(1.0/update.freq));
+
+    update.next = Clock::now();
+
+    try
+    {
+        while (running)
+        {
+            timedCall(update.func, update.freq, -1);
+
+            update.next += period;
+
+            auto now = Clock::now();
+            if (now - update.next > period*maxCatchUp) update.next = now;
+
+            std::this_thread::sleep_until(update.next);
+        }
+    }
+    catch (...)
+    {
+        // Rethrown by go() once this thread is joined
+        updateError = std::current_exception();
+        running = false;
+    }
+}
+
+void Core::timedCall(const std::function<void()>& func, double freq, int index)
+{
+    const auto start = Clock::now();
+    func();
+    const auto end = Clock::now();
+
+    const double budget = 1.0/freq;
+    const double elapsed = std::chrono::duration<double>(end-start).count();
+
+    if (elapsed > budget)
+    {
+        ++overruns;
+        if (overrunHandler) overrunHandler({index, budget, elapsed, start, end});
+    }
 }
 
 const Shader& Core::getShader() const
@@ -307,15 +617,28 @@ void Core::setShader(const Shader& in)
 {
     shader = in;
     shader.bind();
+    initUniformIDs();
+}
+
+void Core::initUniformIDs()
+{
+    uniformIDs.projectionMatrix = shader.getUniformID("projectionMatrix");
+    uniformIDs.viewMatrix       = shader.getUniformID("viewMatrix");
+    uniformIDs.modelMatrix      = shader.getUniformID("modelMatrix");
+    uniformIDs.MVP              = shader.getUniformID("MVP");
+
+    cameraBlock = shader.bindBlock("Camera", 0);
 }
 
 int Core::getWindowAttrib(int param) const
 {
+    if (!window) return 0;
     return glfwGetWindowAttrib(window, param);
 }
 
 bool Core::shouldClose() const
 {
+    if (!window) return false;
     return glfwWindowShouldClose(window);
 }
 
@@ -34,6 +34,10 @@
 #include "transform.hpp"
 #include "utility.hpp"
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
 #include <functional>
 #include <list>
 #include <string>
@@ -62,6 +66,7 @@ public:
         bool fullscreen;    //!< Fullscreen mode.
         bool vsync;         //!< Waits for vertical sync.
         int fsaaSamples;    //!< Number of samples to use for FSAA.
+        bool headless;      //!< Render offscreen, without a window.
     };
 
     Core() = delete;
@@ -70,6 +75,11 @@ public:
      *
      *  Constructs a core and opens a window using the given parameters.
      *
+     *  If RenderParams::headless is set, no window is opened. Instead, an EGL
+     *  surfaceless context renders into an offscreen framebuffer, which works
+     *  on software renderers such as Mesa llvmpipe. This requires building
+     *  with @a INU_HEADLESS defined and linking against EGL.
+     *
      *  @param params A completed @ref RenderParams.
      */
     Core(const RenderParams &params);
@@ -109,6 +119,29 @@ public:
      */
     void endFrame();
 
+    /*! @brief Starts or stops frame capture.
+     *
+     *  While capturing, endFrame() waits for the frame to finish rendering
+     *  and records how long it took since beginFrame(). If a prefix is given,
+     *  every frame is also written to a numbered PNG file.
+     *
+     *  @param times Record frame times.
+     *  @param pngPrefix Path prefix for PNG files, or empty for none.
+     */
+    void captureFrames(bool times, const std::string& pngPrefix = "");
+
+    /*! @brief Gets the recorded frame times.
+     *
+     *  @return Duration of each captured frame, in seconds.
+     */
+    const std::vector<double>& getFrameTimes() const;
+
+    /*! @brief Reads back the current frame.
+     *
+     *  @return Contents of the color buffer.
+     */
+    Image readFrame() const;
+
     /*! @brief Returns the current graphical framerate.
      */
     double getInstantFrameRate() const;
@@ -121,6 +154,18 @@ public:
      *
      *  The given camera's matrices are uploaded to the gpu.
      *
+     *  If the shader declares a uniform block named @a Camera, the matrices
+     *  are written to a uniform buffer bound to it instead:
+     *
+     *  @code
+     *  layout (std140) uniform Camera
+     *  {
+     *      mat4 projectionMatrix;
+     *      mat4 viewMatrix;
+     *      mat4 viewProjection;
+     *  };
+     *  @endcode
+     *
      *  @param in The camera to apply.
      */
     void applyCam(const Camera& in);
@@ -154,7 +199,8 @@ public:
     /*! @brief Adds a callback.
      *
      *  Sets the given function to be called during the @ref go() cycle at the
-     *  given frequency.
+     *  given frequency. Callbacks always run on the thread that called
+     *  @ref go(), so they may draw.
      *
      *  @param func Function to add.
      *  @param freq Call frequency, in Hertz.
@@ -165,10 +211,55 @@ public:
      */
     void clearCallbacks();
 
+    /*! @brief Sets the update function.
+     *
+     *  The given function will be called on its own thread during the
+     *  @ref go() cycle, at a fixed timestep of the given frequency. It must not
+     *  touch the OpenGL context. Input should be read with Interface::poll()
+     *  from inside the update function.
+     *
+     *  @param func Function to call, or an empty function to disable.
+     *  @param freq Update frequency, in Hertz.
+     */
+    void setUpdate(std::function<void()> func, double freq);
+
+    /*! @brief A call that ran past its budget.
+     */
+    struct Overrun
+    {
+        int callback;   //!< Index of the callback, or -1 for the update function.
+        double budget;  //!< Time allowed by the frequency, in seconds.
+        double elapsed; //!< Time taken, in seconds.
+        std::chrono::steady_clock::time_point start; //!< When the call started.
+        std::chrono::steady_clock::time_point end;   //!< When the call returned.
+    };
+
+    /*! @brief Sets the function called when a call runs past its budget.
+     *
+     *  Each callback and the update function may take 1/freq seconds per
+     *  call. The handler is called right after a call that took longer, on
+     *  the thread that made it, so it must be thread-safe if an update
+     *  function is set. Callbacks with a negative frequency have no budget.
+     *
+     *  @param func Function to call, or an empty function to disable.
+     */
+    void setOverrunHandler(std::function<void(const Overrun&)> func);
+
+    /*! @brief Gets the number of calls that ran past their budget.
+     *
+     *  @return Overruns since construction.
+     */
+    std::uint64_t getOverruns() const;
+
     /*! @brief Starts the scheduler.
      *
      *  This functions runs a loop that calls registered functions at the
-     *  specified frequencies. The loop continues while Core::running is true.
+     *  specified frequencies, sleeping until the next one is due. If an update
+     *  function is set, it is run on a second thread while this thread pumps
+     *  window events. The loop continues while Core::running is true.
+     *
+     *  An exception thrown by the update function stops the loop, and is
+     *  rethrown here once the update thread has finished.
      */
     void go();
 
@@ -210,9 +301,10 @@ public:
 
     /*! @brief True if the core is running.
      *
-     *  Set this to @a false at any time to exit the go() cycle.
+     *  Set this to @a false at any time, from any thread, to exit the go()
+     *  cycle.
      */
-    bool running;
+    std::atomic<bool> running;
 
     /*! @brief The core's human Interface.
      */
@@ -220,11 +312,13 @@ public:
 
 private:
     using Window = GLFWwindow*;
+    using Clock = std::chrono::steady_clock;
 
     struct Callback
     {
         std::function<void()> func;
-        double freq, last;
+        double freq;
+        Clock::time_point next;
     };
 
     static void init();
@@ -232,9 +326,20 @@ private:
 
     static int numCores;
 
+    void openOffscreen();
+    void closeOffscreen();
+
     std::vector<Callback> callbacks;
+    Callback update;
+    std::exception_ptr updateError; // Thrown by the update function
 
-    double frameStartTime;
+    std::function<void(const Overrun&)> overrunHandler;
+    std::atomic<std::uint64_t> overruns;
+
+    void updateLoop();
+    void timedCall(const std::function<void()>& func, double freq, int index);
+
+    Clock::time_point frameStartTime;
     std::list<double> frameRateStack;
     std::list<double>::iterator frStackIterator;
 
@@ -246,9 +351,40 @@ private:
 
     Window window;
 
+    struct
+    {
+        void* display;
+        void* context;
+        GLuint framebuffer;
+        GLuint color;
+        GLuint depth;
+    } offscreen;
+
+    struct
+    {
+        bool times;
+        std::string prefix;
+        unsigned long frame;
+    } capture;
+
+    std::vector<double> frameTimes;
+
     Mat4 viewProjection;
 
     Shader shader;
+
+    struct
+    {
+        Shader::UniformID projectionMatrix;
+        Shader::UniformID viewMatrix;
+        Shader::UniformID modelMatrix;
+        Shader::UniformID MVP;
+    } uniformIDs;
+
+    GLuint cameraBuffer;
+    bool cameraBlock;
+
+    void initUniformIDs();
 };
 
 } // namespace Inugami
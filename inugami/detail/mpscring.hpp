@@ -0,0 +1,138 @@
+/*******************************************************************************
+ * Inugami - An OpenGL framework designed for rapid game development
+ * Version: 0.2.0
+ * https://github.com/DBRalir/Inugami
+ *
+ * Copyright (c) 2012 Jeramy Harrison <dbralir@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#ifndef INUGAMI_DETAIL_MPSCRING_HPP
+#define INUGAMI_DETAIL_MPSCRING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace Inugami {
+
+/*! @brief Bounded queue for many writers and one reader.
+ *
+ *  Each slot carries a sequence number that tells writers when it is free
+ *  and the reader when it is full, so neither side ever takes a lock. Slots
+ *  are reused, and the capacity is rounded up to a power of two.
+ */
+template <typename T>
+class MPSCRing
+{
+public:
+    /*! @brief Primary constructor.
+     *
+     *  @param capacity Minimum number of slots.
+     */
+    explicit MPSCRing(std::size_t capacity)
+        : cells()
+        , mask(0)
+        , head(0)
+        , tail(0)
+    {
+        std::size_t size = 1;
+        while (size < capacity) size <<= 1;
+
+        cells.reset(new Cell[size]);
+        mask = size-1;
+
+        for (std::size_t i=0; i<size; ++i) cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    MPSCRing(const MPSCRing&) = delete;
+    MPSCRing& operator=(const MPSCRing&) = delete;
+
+    /*! @brief Adds an item, from any thread.
+     *
+     *  @return @a False if the queue is full.
+     */
+    bool push(T&& in)
+    {
+        std::size_t pos = head.load(std::memory_order_relaxed);
+
+        for (;;)
+        {
+            Cell& cell = cells[pos & mask];
+            std::size_t seq = cell.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq - pos);
+
+            if (diff == 0)
+            {
+                if (head.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed))
+                {
+                    cell.data = std::move(in);
+                    cell.sequence.store(pos+1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0) return false;
+            else pos = head.load(std::memory_order_relaxed);
+        }
+    }
+
+    /*! @brief Takes the oldest item, from the reading thread only.
+     *
+     *  @return @a False if the queue is empty.
+     */
+    bool pop(T& out)
+    {
+        Cell& cell = cells[tail & mask];
+        std::size_t seq = cell.sequence.load(std::memory_order_acquire);
+
+        if (seq != tail+1) return false;
+
+        out = std::move(cell.data);
+        cell.sequence.store(tail+mask+1, std::memory_order_release);
+        ++tail;
+        return true;
+    }
+
+private:
+    struct Cell
+    {
+        Cell()
+            : sequence(0)
+            , data()
+        {}
+
+        std::atomic<std::size_t> sequence;
+        T data;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    std::size_t mask;
+
+    // Writers and the reader hammer different ends
+    std::atomic<std::size_t> head;
+    char pad[64];
+    std::size_t tail;
+};
+
+} // namespace Inugami
+
+#endif // INUGAMI_DETAIL_MPSCRING_HPP
@@ -0,0 +1,101 @@
+/*******************************************************************************
+ * Inugami - An OpenGL framework designed for rapid game development
+ * Version: 0.2.0
+ * https://github.com/DBRalir/Inugami
+ *
+ * Copyright (c) 2012 Jeramy Harrison <dbralir@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#ifndef INUGAMI_DETAIL_TRIPLEBUFFER_HPP
+#define INUGAMI_DETAIL_TRIPLEBUFFER_HPP
+
+#include <mutex>
+#include <utility>
+
+namespace Inugami {
+
+/*! @brief Hand-off between one writer and one reader.
+ *
+ *  The writer fills back(), then calls publish(). The reader calls acquire()
+ *  and reads front(), which stays untouched until the next acquire(). Neither
+ *  side ever waits on the other for longer than a swap, and all three buffers
+ *  are reused, so nothing is allocated once they have grown to size.
+ */
+template <typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer()
+        : buffers()
+        , writing(0)
+        , ready(1)
+        , reading(2)
+        , fresh(false)
+        , mutex()
+    {}
+
+    /*! @brief Buffer being written.
+     */
+    T& back()
+    {
+        return buffers[writing];
+    }
+
+    /*! @brief Hands the back buffer to the reader.
+     */
+    void publish()
+    {
+        std::lock_guard<std::mutex> lock (mutex);
+        std::swap(writing, ready);
+        fresh = true;
+    }
+
+    /*! @brief Takes the newest published buffer, if any.
+     *
+     *  @return @a True if front() changed.
+     */
+    bool acquire()
+    {
+        std::lock_guard<std::mutex> lock (mutex);
+        if (!fresh) return false;
+        std::swap(reading, ready);
+        fresh = false;
+        return true;
+    }
+
+    /*! @brief Buffer being read.
+     */
+    const T& front() const
+    {
+        return buffers[reading];
+    }
+
+private:
+    T buffers[3];
+    int writing, ready, reading;
+    bool fresh;
+    std::mutex mutex;
+};
+
+} // namespace Inugami
+
+#endif // INUGAMI_DETAIL_TRIPLEBUFFER_HPP
@@ -29,10 +29,12 @@
 
 #include "math.hpp"
 
-#include <png++/png.hpp>
+#include <png.h>
 
 #include <map>
 #include <cmath>
+#include <cstdio>
+#include <memory>
 #include <utility>
 #include <random>
 
@@ -40,28 +42,110 @@ using namespace std;
 
 namespace Inugami {
 
+namespace {
+
+static_assert(sizeof(Image::Pixel) == 4, "Pixels must be tightly packed for libpng!");
+
+// libpng reports errors by longjmp()ing back to the setjmp() of whoever
+// called it, so only the message is kept here
+struct PNGError
+{
+    char message[256];
+};
+
+void onPNGError(png_structp png, png_const_charp message)
+{
+    auto error = static_cast<PNGError*>(png_get_error_ptr(png));
+    snprintf(error->message, sizeof(error->message), "%s", message);
+    png_longjmp(png, 1);
+}
+
+void onPNGWarning(png_structp, png_const_charp)
+{}
+
+using File = unique_ptr<FILE, int(*)(FILE*)>;
+
+} // namespace
+
+ImageException::ImageException(const std::string& what)
+    : err("Image Exception: "+what)
+{}
+
+const char* ImageException::what() const noexcept
+{
+    return err.c_str();
+}
+
 Image Image::fromPNG(const string& filename) //static
 {
+    File file (fopen(filename.c_str(), "rb"), &fclose);
+    if (!file) throw ImageException("Can't open "+filename+"!");
+
+    png_byte signature[8];
+    if (fread(signature, 1, 8, file.get()) != 8 || png_sig_cmp(signature, 0, 8) != 0)
+    {
+        throw ImageException(filename+" is not a PNG file!");
+    }
+
+    PNGError error {""};
+
+    png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, &error, onPNGError, onPNGWarning);
+    if (!png) throw ImageException("Can't create PNG reader!");
+
+    png_infop info = png_create_info_struct(png);
+
+    // Everything touched after setjmp() lives here, not in registers
     Image rval;
+    vector<png_bytep> rows;
+
+    if (!info || setjmp(png_jmpbuf(png)))
+    {
+        png_destroy_read_struct(&png, &info, nullptr);
+        throw ImageException(filename+": "+error.message);
+    }
+
+    png_init_io(png, file.get());
+    png_set_sig_bytes(png, 8);
+    png_read_info(png, info);
 
-    png::image<png::rgba_pixel> image(filename);
+    // Ask libpng for RGBA8, whatever the file holds
+    png_set_expand(png);
+    png_set_strip_16(png);
+    png_set_gray_to_rgb(png);
+    png_set_add_alpha(png, 0xff, PNG_FILLER_AFTER);
+    png_set_interlace_handling(png);
+    png_read_update_info(png, info);
 
-    rval.resize(image.get_width(), image.get_height());
+    const int w = png_get_image_width(png, info);
+    const int h = png_get_image_height(png, info);
 
-    for (int r=0; r<rval.height; ++r)
+    if (png_get_rowbytes(png, info) != w*sizeof(Pixel))
     {
-        for (int c=0; c<rval.width; ++c)
-        {
-            rval.pixelAt(c,r)[0] = image.get_pixel(c,rval.height-r-1).red;
-            rval.pixelAt(c,r)[1] = image.get_pixel(c,rval.height-r-1).green;
-            rval.pixelAt(c,r)[2] = image.get_pixel(c,rval.height-r-1).blue;
-            rval.pixelAt(c,r)[3] = image.get_pixel(c,rval.height-r-1).alpha;
-        }
+        png_error(png, "Unsupported pixel format");
     }
 
+    rval.resize(w, h);
+
+    // Rows are decoded in place, bottom-up, since PNG stores the top first
+    rows.resize(h);
+    for (int r=0; r<h; ++r)
+    {
+        rows[r] = reinterpret_cast<png_bytep>(&rval.pixelAt(0, h-r-1));
+    }
+
+    png_read_image(png, rows.data());
+    png_read_end(png, nullptr);
+
+    png_destroy_read_struct(&png, &info, nullptr);
+
     return rval;
 }
 
+future<Image> Image::fromPNGAsync(const string& filename) //static
+{
+    return async(launch::async, &Image::fromPNG, filename);
+}
+
 Image Image::fromNoise(int w, int h) //static
 {
     Image rval(w, h);
@@ -106,4 +190,42 @@ void Image::resize(int w, int h)
     pixels.resize(width*height);
 }
 
+void Image::toPNG(const string& filename) const
+{
+    File file (fopen(filename.c_str(), "wb"), &fclose);
+    if (!file) throw ImageException("Can't open "+filename+"!");
+
+    PNGError error {""};
+
+    png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, &error, onPNGError, onPNGWarning);
+    if (!png) throw ImageException("Can't create PNG writer!");
+
+    png_infop info = png_create_info_struct(png);
+
+    vector<png_bytep> rows;
+
+    if (!info || setjmp(png_jmpbuf(png)))
+    {
+        png_destroy_write_struct(&png, &info);
+        throw ImageException(filename+": "+error.message);
+    }
+
+    png_init_io(png, file.get());
+    png_set_IHDR(png, info, width, height, 8, PNG_COLOR_TYPE_RGB_ALPHA,
+                 PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+
+    // Rows are written straight from the pixels, top first
+    rows.resize(height);
+    for (int r=0; r<height; ++r)
+    {
+        rows[r] = reinterpret_cast<png_bytep>(const_cast<Pixel*>(&pixelAt(0, height-r-1)));
+    }
+
+    png_write_info(png, info);
+    png_write_image(png, rows.data());
+    png_write_end(png, nullptr);
+
+    png_destroy_write_struct(&png, &info);
+}
+
 } // namespace Inugami
@@ -28,16 +28,25 @@
 #ifndef INUGAMI_IMAGE_H
 #define INUGAMI_IMAGE_H
 
+#include "exception.hpp"
 #include "utility.hpp"
 
-#include <png++/png.hpp>
-
 #include <array>
+#include <future>
 #include <string>
 #include <vector>
 
 namespace Inugami {
 
+class ImageException
+    : public Exception
+{
+public:
+    ImageException(const std::string& what);
+    virtual const char* what() const noexcept override;
+    std::string err;
+};
+
 /*! @brief Container for pixel data.
  *
  *  Describes an image in RGBA8 format. Designed to be converted into a Texture.
@@ -60,14 +69,29 @@ public:
 
     /*! @brief Creates an Image from a PNG file.
      *
-     *  Loads the given PNG file into an Image.
+     *  Loads the given PNG file into an Image. Any PNG color type is
+     *  converted to RGBA8, decoding straight into the Image's pixels.
      *
      *  @param filename Name of PNG file to import.
      *
      *  @return Image imported from the PNG file.
+     *
+     *  @throws ImageException if the file can't be read or decoded.
      */
     static Image fromPNG(const std::string& filename);
 
+    /*! @brief Creates an Image from a PNG file on another thread.
+     *
+     *  Decoding is mostly inflating, which can't be split within one file, so
+     *  large images are best started together and collected once they're
+     *  needed.
+     *
+     *  @param filename Name of PNG file to import.
+     *
+     *  @return Future of the Image, see fromPNG().
+     */
+    static std::future<Image> fromPNGAsync(const std::string& filename);
+
     /*! @brief Creates an Image from random noise.
      *
      *  Creates an Image from random noise.
@@ -120,6 +144,14 @@ public:
      */
     void resize(int w, int h);
 
+    /*! @brief Writes the Image to a PNG file.
+     *
+     *  @param filename File to write.
+     *
+     *  @throws ImageException if the file can't be written.
+     */
+    void toPNG(const std::string& filename) const;
+
     ConstAttr<int,Image> width, height;
 
 private:
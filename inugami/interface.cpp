@@ -34,6 +34,8 @@ namespace Inugami {
 
 bool Interface::callbacksRegistered = false;
 std::map<Interface::Window, Interface*> Interface::windowMap;
+std::mutex Interface::eventMutex;
+std::thread::id Interface::mainThread;
 
 Interface::Proxy::Proxy()
     : iface(nullptr)
@@ -73,9 +75,16 @@ Interface::Interface(Window windowIN)
     , keyStates(), mouseStates()
     , mousePos{0,0}
     , mouseWheel{0.0,0.0}
+    , pending{"", {}, {}, {0.0,0.0}, {0.0,0.0}}
 {
+    std::lock_guard<std::mutex> lock (eventMutex);
+
+    mainThread = std::this_thread::get_id();
     windowMap[window] = this;
 
+    // Headless cores have no window to take input from
+    if (!window) return;
+
     glfwSetKeyCallback         (window, keyboardCallback);
     glfwSetCharCallback        (window, unicodeCallback);
     glfwSetMouseButtonCallback (window, mouseButtonCallback);
@@ -85,19 +94,31 @@ Interface::Interface(Window windowIN)
 
 Interface::~Interface()
 {
-    glfwSetKeyCallback         (window, nullptr);
-    glfwSetCharCallback        (window, nullptr);
-    glfwSetMouseButtonCallback (window, nullptr);
-    glfwSetCursorPosCallback   (window, nullptr);
-    glfwSetScrollCallback      (window, nullptr);
+    if (window)
+    {
+        glfwSetKeyCallback         (window, nullptr);
+        glfwSetCharCallback        (window, nullptr);
+        glfwSetMouseButtonCallback (window, nullptr);
+        glfwSetCursorPosCallback   (window, nullptr);
+        glfwSetScrollCallback      (window, nullptr);
+    }
 
+    std::lock_guard<std::mutex> lock (eventMutex);
     windowMap.erase(windowMap.find(window));
 }
 
 void Interface::poll() //static
 {
-    for (auto&& p : windowMap) if (p.second) p.second->clearPresses();
-    glfwPollEvents();
+    if (std::this_thread::get_id() == mainThread) pump();
+
+    std::lock_guard<std::mutex> lock (eventMutex);
+    for (auto&& p : windowMap) if (p.second) p.second->latch();
+}
+
+void Interface::pump() //static
+{
+    std::lock_guard<std::mutex> lock (eventMutex);
+    if (windowMap.size() > windowMap.count(nullptr)) glfwPollEvents();
 }
 
 bool Interface::keyDown(int key) const
@@ -151,19 +172,22 @@ auto Interface::getMouseWheel() const -> Coord<double>
 
 void Interface::setMousePos(double x, double y)
 {
-    mousePos.x = x;
-    mousePos.y = y;
-    glfwSetCursorPos(window, x, y);
+    std::lock_guard<std::mutex> lock (eventMutex);
+    mousePos.x = pending.mousePos.x = x;
+    mousePos.y = pending.mousePos.y = y;
+    if (window) glfwSetCursorPos(window, x, y);
 }
 
 void Interface::setMouseWheel(double x, double y)
 {
-    mouseWheel.x = x;
-    mouseWheel.y = y;
+    std::lock_guard<std::mutex> lock (eventMutex);
+    mouseWheel.x = pending.mouseWheel.x = x;
+    mouseWheel.y = pending.mouseWheel.y = y;
 }
 
 void Interface::showMouse(bool show) const
 {
+    if (!window) return;
     if (show) glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
     else      glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_HIDDEN);
 }
@@ -173,10 +197,17 @@ Interface::Proxy Interface::getProxy(int k)
     return Proxy(this, k);
 }
 
-void Interface::clearPresses()
+void Interface::latch()
 {
-    keyStates.presses.reset();
-    mouseStates.presses.reset();
+    keyStates = pending.keyStates;
+    mouseStates = pending.mouseStates;
+    mousePos = pending.mousePos;
+    mouseWheel = pending.mouseWheel;
+    keyBuffer += pending.keyBuffer;
+
+    pending.keyStates.presses.reset();
+    pending.mouseStates.presses.reset();
+    pending.keyBuffer.clear();
 }
 
 void Interface::keyboardCallback(Window win, int key, int, int action, int) //static
@@ -186,12 +217,12 @@ void Interface::keyboardCallback(Window win, int key, int, int action, int) //st
     if (!iface) return;
     if (action == GLFW_PRESS)
     {
-        iface->keyStates.states.set(key);
-        iface->keyStates.presses.set(key);
+        iface->pending.keyStates.states.set(key);
+        iface->pending.keyStates.presses.set(key);
     }
     else if (action == GLFW_RELEASE)
     {
-        iface->keyStates.states.reset(key);
+        iface->pending.keyStates.states.reset(key);
     }
 }
 
@@ -200,7 +231,7 @@ void Interface::unicodeCallback(Window win, unsigned int key) //static
     if (key > 255) return;
     Interface* iface = windowMap[win];
     if (!iface) return;
-    iface->keyBuffer += char(key);
+    iface->pending.keyBuffer += char(key);
 }
 
 void Interface::mouseButtonCallback(Window win, int button, int action, int) //static
@@ -210,12 +241,12 @@ void Interface::mouseButtonCallback(Window win, int button, int action, int) //s
     if (button < 0 || button > GLFW_MOUSE_BUTTON_LAST) return;
     if (action == GLFW_PRESS)
     {
-        iface->mouseStates.states[button] = true;
-        iface->mouseStates.presses[button] = true;
+        iface->pending.mouseStates.states[button] = true;
+        iface->pending.mouseStates.presses[button] = true;
     }
     else if (action == GLFW_RELEASE)
     {
-        iface->mouseStates.states[button] = false;
+        iface->pending.mouseStates.states[button] = false;
     }
 }
 
@@ -223,16 +254,16 @@ void Interface::mousePositionCallback(Window win, double x, double y) //static
 {
     Interface* iface = windowMap[win];
     if (!iface) return;
-    iface->mousePos.x = x;
-    iface->mousePos.y = y;
+    iface->pending.mousePos.x = x;
+    iface->pending.mousePos.y = y;
 }
 
 void Interface::mouseWheelCallback(Window win, double x, double y) //static
 {
     Interface* iface = windowMap[win];
     if (!iface) return;
-    iface->mouseWheel.x = x;
-    iface->mouseWheel.y = y;
+    iface->pending.mouseWheel.x = x;
+    iface->pending.mouseWheel.y = y;
 }
 
 } // namespace Inugami
@@ -36,6 +36,8 @@
 #include <list>
 #include <vector>
 #include <map>
+#include <mutex>
+#include <thread>
 
 namespace Inugami {
 
@@ -56,7 +58,7 @@ public:
 
     /*! @brief Primary constructor.
      *
-     *  @param windowIn Window to attach.
+     *  @param windowIn Window to attach, or @a nullptr for no input.
      */
     Interface(Window windowIn);
 
@@ -127,10 +129,22 @@ public:
 
     /*! @brief Checks for new input events.
      *
-     *  It is recommended to call this once every frame.
+     *  Makes all input received since the last poll visible. When called from
+     *  the main thread, this also calls pump().
+     *
+     *  It is recommended to call this once every frame or tick.
      */
     static void poll();
 
+    /*! @brief Receives window events.
+     *
+     *  Window events are buffered until the next call to poll(), which may
+     *  come from another thread.
+     *
+     *  @note Must be called from the main thread.
+     */
+    static void pump();
+
     /*! @brief Get the key's state.
      *
      *  @param key Keycode.
@@ -235,8 +249,19 @@ private:
         std::bitset<m> states, presses;
     };
 
+    struct Pending
+    {
+        std::string keyBuffer;
+        State<GLFW_KEY_LAST+1> keyStates;
+        State<GLFW_MOUSE_BUTTON_LAST+1> mouseStates;
+        Coord<double> mousePos;
+        Coord<double> mouseWheel;
+    };
+
     static bool callbacksRegistered;
     static std::map<Window, Interface*> windowMap;
+    static std::mutex eventMutex;
+    static std::thread::id mainThread;
 
     static void keyboardCallback(Window win, int key, int, int action, int);
     static void unicodeCallback(Window win, unsigned int key);
@@ -244,7 +269,7 @@ private:
     static void mousePositionCallback(Window win, double x, double y);
     static void mouseWheelCallback(Window win, double x, double y);
 
-    void clearPresses();
+    void latch();
 
     Window window;
 
@@ -254,6 +279,8 @@ private:
 
     Coord<double> mousePos;
     Coord<double> mouseWheel;
+
+    Pending pending;
 };
 
 } // namespace Inugami
@@ -38,10 +38,14 @@ class Geometry;
 class Image;
 class Interface;
 class Mesh;
+class MeshArena;
+class NumberText;
+class Palette;
 class Profiler;
 class Shader;
 class ShaderProgram;
 class Spritesheet;
+class TextBatch;
 class Texture;
 class Transform;
 
@@ -28,11 +28,21 @@
 #ifndef INUGAMI_LOGGER_H
 #define INUGAMI_LOGGER_H
 
+#include "binlog.hpp"
 #include "utility.hpp"
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
 #include <ostream>
 #include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <vector>
 
 namespace Inugami {
 
@@ -90,7 +100,15 @@ public:
     template <unsigned int PRIORITY, typename... T>
     Log& log(const T&... args)
     {
-        return logger.log<PRIORITY>(args...);
+        return logger.template log<PRIORITY>(args...);
+    }
+
+    /*! @brief Proxy to Logger::logFormat().
+     */
+    template <unsigned int PRIORITY, typename... T>
+    Log& logFormat(const LogFormat& fmt, const T&... args)
+    {
+        return logger.template logFormat<PRIORITY>(fmt, args...);
     }
 
 private:
@@ -98,6 +116,55 @@ private:
     std::string before;
 };
 
+/*! @brief What an asynchronous Logger does when its queue is full.
+ */
+enum class LogOverflow
+{
+      DROP  //!< Discard the line and count it.
+    , BLOCK //!< Wait for the writer thread to make room.
+};
+
+/*! @brief Automatic asynchronous mode manager for a Logger.
+ *
+ *  For the lifetime of this object, the referenced Logger writes from a
+ *  background thread. Create it after the output streams and before other
+ *  threads start logging, so that it is destroyed first.
+ *
+ *  @tparam Type of Logger.
+ */
+template <typename Log>
+class AsyncLog
+{
+public:
+    AsyncLog(const AsyncLog&) = delete;
+    AsyncLog& operator=(const AsyncLog&) = delete;
+
+    /*! @brief Pointer constructor.
+     *
+     *  @param logIn The Logger to manage.
+     *  @param capacity Lines that can be queued.
+     *  @param policy What to do when the queue is full.
+     *  @param binary Output for a binary log, see Logger::startAsync().
+     */
+    AsyncLog(Log *const logIn, std::size_t capacity, LogOverflow policy, std::ostream* binary = nullptr)
+        : logger(*logIn)
+    {
+        logger.startAsync(capacity, policy, binary);
+    }
+
+    /*! @brief Destructor.
+     *
+     *  Writes every queued line.
+     */
+    ~AsyncLog()
+    {
+        logger.stopAsync();
+    }
+
+private:
+    Log& logger;
+};
+
 /*! @brief Template-optimized logger.
  *
  *  This logger can be used for priority-based logging. This works under the
@@ -127,6 +194,11 @@ public:
         , stream2(nullptr)
         , delStreams(false)
         , prefix("")
+        , mutex()
+        , recent()
+        , recentSize(0)
+        , recentMutex()
+        , async()
     {}
 
     /*! @brief Secondary constructor.
@@ -141,6 +213,11 @@ public:
         , stream2(&stream2In)
         , delStreams(false)
         , prefix("")
+        , mutex()
+        , recent()
+        , recentSize(0)
+        , recentMutex()
+        , async()
     {}
 
     /*! @brief File constructor.
@@ -155,12 +232,19 @@ public:
         , stream2(nullptr)
         , delStreams(true)
         , prefix("")
+        , mutex()
+        , recent()
+        , recentSize(0)
+        , recentMutex()
+        , async()
     {}
 
     /*! @brief Destructor.
      */
     ~Logger()
     {
+        stopAsync();
+
         if (delStreams)
         {
             delete stream1;
@@ -178,6 +262,11 @@ public:
      *  the minimum secondary priority and less than the max priority, the text
      *  will also be written to the secondary output.
      *
+     *  Lines from different threads are never interleaved.
+     *
+     *  In asynchronous mode the line is formatted here, but written and
+     *  flushed later by a background thread.
+     *
      *  @tparam PRIORITY Priority of this line of text.
      *  @param args Variadic list of items that can be inserted into a stream.
      *
@@ -188,16 +277,283 @@ public:
     {
         if (PRIORITY <= MAXPRIORITY)
         {
+            if (async)
+            {
+                std::ostringstream ss;
+                print(ss, "[", PRIORITY, "] ", prefix, args...);
+                queue({ss.str(), PRIORITY >= SECONDARY});
+                return *this;
+            }
+
+            std::lock_guard<std::mutex> lock (mutex);
+
             if (PRIORITY >= SECONDARY)
             {
                 if (stream2) print2("[", PRIORITY, "] ", prefix, args...);
             }
             if (stream1) print1("[", PRIORITY, "] ", prefix, args...);
+
+            if (recentSize > 0)
+            {
+                std::ostringstream ss;
+                print(ss, "[", PRIORITY, "] ", prefix, args...);
+                remember(ss.str());
+            }
+        }
+        return *this;
+    }
+
+    /*! @brief Sends a line through a LogFormat.
+     *
+     *  Use INU_LOG() instead of calling this directly. With a binary log the
+     *  arguments are copied as they are, and formatted by BinLog::decode().
+     *  Otherwise this is the same as log() with the format expanded.
+     *
+     *  @tparam PRIORITY Priority of this line of text.
+     *  @param fmt Format of the line.
+     *  @param args Arguments for each "{}" in the format.
+     *
+     *  @return *this
+     */
+    template <unsigned int PRIORITY, typename... T>
+    Logger& logFormat(const LogFormat& fmt, const T&... args)
+    {
+        if (PRIORITY <= MAXPRIORITY)
+        {
+            if (async && async->records)
+            {
+                auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - async->start).count();
+
+                BinLog::Record rec;
+                BinLog::encodeLine(rec, fmt, PRIORITY, nanos, prefix, args...);
+                queue(std::move(rec));
+
+                // Only formatted here when someone wants it as text
+                if (recentSize > 0)
+                {
+                    std::ostringstream ss;
+                    print(ss, "[", PRIORITY, "] ", prefix, BinLog::expandNow(fmt, args...));
+                    remember(ss.str());
+                }
+                return *this;
+            }
+
+            log<PRIORITY>(BinLog::expandNow(fmt, args...));
         }
         return *this;
     }
 
+    /*! @brief Starts writing from a background thread.
+     *
+     *  Queueing a line never takes a lock, and the outputs are flushed once
+     *  per batch of lines instead of once per line. This must not be called
+     *  while other threads are logging.
+     *
+     *  If a binary output is given, lines sent through INU_LOG() go to it
+     *  instead, unformatted, with timestamps relative to this call. The
+     *  output should be opened in binary mode, and is decoded with
+     *  BinLog::decode().
+     *
+     *  @param capacity Lines that can be queued.
+     *  @param policy What to do when the queue is full.
+     *  @param binary Output for a binary log, or @a nullptr.
+     */
+    void startAsync(std::size_t capacity, LogOverflow policy, std::ostream* binary = nullptr)
+    {
+        if (async) return;
+        async.reset(new Async(capacity, policy, binary));
+        async->writer = std::thread([this]{ writeLoop(); });
+    }
+
+    /*! @brief Writes every queued line and goes back to writing directly.
+     *
+     *  This must not be called while other threads are logging.
+     */
+    void stopAsync()
+    {
+        if (!async) return;
+        async->running = false;
+        async->writer.join();
+        async.reset();
+    }
+
+    /*! @brief Gets the number of lines dropped by LogOverflow::DROP.
+     */
+    std::uint64_t getDropped() const
+    {
+        return (async)? async->dropped.load() : 0;
+    }
+
+    /*! @brief Keeps the most recent lines for getRecent().
+     *
+     *  In asynchronous mode a line is kept once the background thread has
+     *  written it, except for lines sent to a binary log, which are
+     *  formatted and kept as they are logged.
+     *
+     *  @param lines Lines to keep, or 0 to stop keeping them.
+     */
+    void keepRecent(std::size_t lines)
+    {
+        std::lock_guard<std::mutex> lock (recentMutex);
+        recentSize = lines;
+        while (recent.size() > recentSize) recent.pop_front();
+    }
+
+    /*! @brief Gets the most recent lines, oldest first.
+     *
+     *  @see keepRecent()
+     */
+    std::vector<std::string> getRecent()
+    {
+        std::lock_guard<std::mutex> lock (recentMutex);
+        return {recent.begin(), recent.end()};
+    }
+
 private:
+    struct Line
+    {
+        Line()
+            : text()
+            , secondary(false)
+        {}
+
+        Line(std::string t, bool s)
+            : text(std::move(t))
+            , secondary(s)
+        {}
+
+        std::string text;
+        bool secondary;
+    };
+
+    struct Async
+    {
+        Async(std::size_t capacity, LogOverflow p, std::ostream* b)
+            : ring(capacity)
+            , records((b)? new MPSCRing<BinLog::Record>(capacity) : nullptr)
+            , binary(b)
+            , start(std::chrono::steady_clock::now())
+            , policy(p)
+            , running(true)
+            , dropped(0)
+            , writer()
+        {}
+
+        Async(const Async&) = delete;
+        Async& operator=(const Async&) = delete;
+
+        MPSCRing<Line> ring;
+        std::unique_ptr<MPSCRing<BinLog::Record>> records;
+        std::ostream* binary;
+        const std::chrono::steady_clock::time_point start;
+        const LogOverflow policy;
+        std::atomic<bool> running;
+        std::atomic<std::uint64_t> dropped;
+        std::thread writer;
+    };
+
+    void queue(Line&& line)
+    {
+        queue([&]{ return async->ring.push(std::move(line)); });
+    }
+
+    void queue(BinLog::Record&& rec)
+    {
+        queue([&]{ return async->records->push(std::move(rec)); });
+    }
+
+    template <typename Push>
+    void queue(const Push& push)
+    {
+        while (!push())
+        {
+            if (async->policy == LogOverflow::DROP)
+            {
+                ++async->dropped;
+                return;
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    void writeLoop()
+    {
+        std::uint64_t reported = 0;
+        Line line;
+        BinLog::Record rec;
+        std::vector<bool> described;
+
+        if (async->binary) async->binary->write(BinLog::MAGIC, sizeof(BinLog::MAGIC)-1);
+
+        for (;;)
+        {
+            // Checked before draining, so nothing queued before stopAsync() is lost
+            bool stopping = !async->running;
+            bool wrote = false;
+
+            while (async->ring.pop(line))
+            {
+                if (line.secondary && stream2) *stream2 << line.text << '\n';
+                if (stream1) *stream1 << line.text << '\n';
+                if (recentSize > 0) remember(std::move(line.text));
+                wrote = true;
+            }
+
+            while (async->records && async->records->pop(rec))
+            {
+                // Each format is described before its first line
+                std::uint32_t id = BinLog::lineFormat(rec);
+                if (id >= described.size()) described.resize(id+1, false);
+                if (!described[id])
+                {
+                    BinLog::writeFormat(*async->binary, *LogFormat::find(id));
+                    described[id] = true;
+                }
+
+                async->binary->write(rec.bytes, rec.size);
+                wrote = true;
+            }
+
+            std::uint64_t dropped = async->dropped;
+            if (dropped != reported)
+            {
+                if (stream1) *stream1 << "[0] Logger: Dropped " << dropped-reported << " lines\n";
+                reported = dropped;
+                wrote = true;
+            }
+
+            if (wrote)
+            {
+                if (async->binary) async->binary->flush();
+                if (stream2) stream2->flush();
+                if (stream1) stream1->flush();
+            }
+            else if (stopping) break;
+            else std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+    }
+
+    void remember(std::string&& text)
+    {
+        std::lock_guard<std::mutex> lock (recentMutex);
+        if (recentSize == 0) return;
+        if (recent.size() >= recentSize) recent.pop_front();
+        recent.push_back(std::move(text));
+    }
+
+    template <typename T>
+    static void print(std::ostream& out, const T& a)
+    {
+        out << a;
+    }
+
+    template <typename T, typename... VT>
+    static void print(std::ostream& out, const T& a, const VT&... args)
+    {
+        out << a;
+        print(out, args...);
+    }
+
     std::ostream *stream1;
     std::ostream *stream2;
 
@@ -205,6 +561,14 @@ private:
 
     std::string prefix;
 
+    std::mutex mutex;
+
+    std::deque<std::string> recent;
+    std::atomic<std::size_t> recentSize;
+    std::mutex recentMutex; // Guards recent
+
+    std::unique_ptr<Async> async;
+
     template <typename T>
     void print1(const T& a)
     {
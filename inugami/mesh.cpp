@@ -32,90 +32,108 @@
 #include "mathtypes.hpp"
 #include "utility.hpp"
 
+#include <atomic>
+#include <cstddef>
 #include <sstream>
 #include <string>
 
 namespace Inugami {
 
-#ifndef INU_MESH_FALLBACK
+static std::atomic<std::uint64_t> drawCalls (0);
 
-template <class Container>
-static void initVertexArray(GLuint vertexArray, GLuint elementArray, const Container& data)
+std::uint64_t Mesh::getDrawCalls() //static
 {
-    glBindVertexArray(vertexArray);
-    glEnableVertexAttribArray(0);
-    glEnableVertexAttribArray(1);
-    glEnableVertexAttribArray(2);
+    return drawCalls.load(std::memory_order_relaxed);
+}
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Geometry::Vertex), reinterpret_cast<GLvoid*>(0));
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Geometry::Vertex), reinterpret_cast<GLvoid*>(sizeof(Vec3)));
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Geometry::Vertex), reinterpret_cast<GLvoid*>(sizeof(Vec3)*2));
+#ifndef INU_MESH_FALLBACK
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementArray);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(typename Container::value_type)*data.size(), &data[0], GL_STATIC_DRAW);
+// Plain draws leave attributes 3-6 disabled, so shaders read these values.
+// They have to be restored after every instanced draw, since drawing with an
+// enabled array leaves the current value undefined.
+static void resetInstanceDefaults()
+{
+    glVertexAttrib3f(3, 0.f, 0.f, 0.f);
+    glVertexAttrib3f(4, 1.f, 1.f, 1.f);
+    glVertexAttrib4f(5, 1.f, 1.f, 1.f, 1.f);
+    glVertexAttrib4f(6, 0.f, 0.f, 0.f, 0.f);
 }
 
-static void drawVertexArray(GLuint vertexArray, GLuint mode, GLuint elementCount)
+template <class Container>
+static void appendIndices(std::vector<GLuint>& out, const Container& data)
 {
-    if (elementCount > 0)
+    for (auto&& prim : data)
     {
-        glBindVertexArray(vertexArray);
-        glDrawElements(mode, elementCount, GL_UNSIGNED_INT, nullptr);
+        for (int i : prim) out.push_back(i);
     }
 }
 
-Mesh::Shared::Shared()
-    : vertexBuffer(0)
-    , pointArray(0)
-    , pointElements(0)
-    , lineArray(0)
-    , lineElements(0)
-    , triangleArray(0)
-    , triangleElements(0)
-    , pointCount(0)
-    , lineCount(0)
-    , triangleCount(0)
+Mesh::Mesh(const Geometry& in)
+    : block()
+    , parts()
+    , numParts(0)
 {
-    glGenBuffers(1, &vertexBuffer);
-    glGenVertexArrays(1, &pointArray);
-    glGenVertexArrays(1, &lineArray);
-    glGenVertexArrays(1, &triangleArray);
-    glGenBuffers(1, &pointElements);
-    glGenBuffers(1, &lineElements);
-    glGenBuffers(1, &triangleElements);
-}
+    std::vector<GLuint> indices;
+    indices.reserve(in.triangles.size()*3 + in.lines.size()*2 + in.points.size());
 
-Mesh::Shared::~Shared()
-{
-    glDeleteBuffers(1, &triangleElements);
-    glDeleteBuffers(1, &lineElements);
-    glDeleteBuffers(1, &pointElements);
-    glDeleteVertexArrays(1, &triangleArray);
-    glDeleteVertexArrays(1, &lineArray);
-    glDeleteVertexArrays(1, &pointArray);
-    glDeleteBuffers(1, &vertexBuffer);
+    // Empty primitive sets get no Part, so drawing them costs nothing
+    auto addPart = [&](GLenum mode, std::size_t first)
+    {
+        if (indices.size() > first)
+        {
+            parts[numParts++] = Part{mode, GLuint(first), GLsizei(indices.size()-first)};
+        }
+    };
+
+    std::size_t first = indices.size();
+    appendIndices(indices, in.triangles);
+    addPart(GL_TRIANGLES, first);
+
+    first = indices.size();
+    appendIndices(indices, in.lines);
+    addPart(GL_LINES, first);
+
+    first = indices.size();
+    appendIndices(indices, in.points);
+    addPart(GL_POINTS, first);
+
+    block = MeshArena::allocate(in.vertices, indices);
+
+    resetInstanceDefaults();
 }
 
-Mesh::Mesh(const Geometry& in)
-    : share(new Shared)
+void Mesh::draw() const
 {
-    glBindBuffer(GL_ARRAY_BUFFER, share->vertexBuffer);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(Geometry::Vertex)*in.vertices.size(), &in.vertices[0], GL_STATIC_DRAW);
+    if (numParts == 0) return;
+
+    MeshArena::bind(*block->page);
 
-    initVertexArray(share->pointArray   , share->pointElements   , in.points);
-    initVertexArray(share->lineArray    , share->lineElements    , in.lines);
-    initVertexArray(share->triangleArray, share->triangleElements, in.triangles);
+    drawCalls.fetch_add(numParts, std::memory_order_relaxed);
 
-    share->pointCount    = in.points   .size();
-    share->lineCount     = in.lines    .size()*2;
-    share->triangleCount = in.triangles.size()*3;
+    for (int i=0; i<numParts; ++i)
+    {
+        const Part& p = parts[i];
+        const std::size_t offset = (block->firstIndex + p.first)*sizeof(GLuint);
+        glDrawElementsBaseVertex(p.mode, p.count, GL_UNSIGNED_INT, reinterpret_cast<GLvoid*>(offset), block->baseVertex);
+    }
 }
 
-void Mesh::draw() const
+void Mesh::drawInstanced(const std::vector<Instance>& instances) const
 {
-    drawVertexArray(share->triangleArray, GL_TRIANGLES, share->triangleCount);
-    drawVertexArray(share->lineArray, GL_LINES, share->lineCount);
-    drawVertexArray(share->pointArray, GL_POINTS, share->pointCount);
+    if (instances.empty() || numParts == 0) return;
+
+    MeshArena::bindInstanced(*block->page, sizeof(Instance)*instances.size(), &instances[0]);
+
+    drawCalls.fetch_add(numParts, std::memory_order_relaxed);
+
+    for (int i=0; i<numParts; ++i)
+    {
+        const Part& p = parts[i];
+        const std::size_t offset = (block->firstIndex + p.first)*sizeof(GLuint);
+        glDrawElementsInstancedBaseVertex(p.mode, p.count, GL_UNSIGNED_INT, reinterpret_cast<GLvoid*>(offset), instances.size(), block->baseVertex);
+    }
+
+    resetInstanceDefaults();
 }
 
 #else
@@ -126,6 +144,8 @@ Mesh::Mesh(const Geometry& in)
 
 void Mesh::draw() const
 {
+    drawCalls.fetch_add(1, std::memory_order_relaxed);
+
     glBegin(GL_TRIANGLES);
     for (auto&& tri : geo.triangles)
     {
@@ -139,6 +159,21 @@ void Mesh::draw() const
     glEnd();
 }
 
+void Mesh::drawInstanced(const std::vector<Instance>& instances) const
+{
+    for (const Instance& inst : instances)
+    {
+        glPushMatrix();
+        glTranslatef(inst.offset.x, inst.offset.y, inst.offset.z);
+        glScalef(inst.scale.x, inst.scale.y, inst.scale.z);
+        glColor4f(inst.color.x, inst.color.y, inst.color.z, inst.color.w);
+        draw();
+        glPopMatrix();
+    }
+
+    glColor4f(1.f, 1.f, 1.f, 1.f);
+}
+
 #endif // INU_MESH_FALLBACK
 
 } // namespace Inugami
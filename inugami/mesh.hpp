@@ -30,21 +30,46 @@
 
 #include "inugami.hpp"
 #include "geometry.hpp"
+#include "mathtypes.hpp"
+#include "mesharena.hpp"
 
 #include "opengl.hpp"
 
+#include <array>
+#include <cstdint>
 #include <memory>
+#include <vector>
 
 namespace Inugami {
 
 /*! @brief Mesh handle.
  *
- *  This class is basically a wrapper for OpenGL vertex arrays.
+ *  This class is basically a wrapper for OpenGL vertex arrays. Mesh data is
+ *  stored in a shared MeshArena.
  */
 class Mesh
 {
     Mesh() = delete;
 public:
+    /*! @brief Per-instance data for instanced drawing.
+     *
+     *  Each vertex is scaled by @a scale and moved by @a offset before the
+     *  model matrix is applied. Shaders receive these at attribute locations
+     *  3 (offset), 4 (scale), 5 (color), and 6 (anim).
+     *
+     *  The meaning of @a anim is up to the shader. It is intended to hold an
+     *  animation kind, its start time, and parameters, so that animations
+     *  can be evaluated on the GPU against a time uniform.
+     */
+    class Instance
+    {
+    public:
+        Vec3 offset;
+        Vec3 scale;
+        Vec4 color;
+        Vec4 anim;
+    };
+
     /*! @brief Primary constructor.
      *
      *  Uploads a Geometry to the GPU. The Geometry can be safely deleted after
@@ -58,24 +83,33 @@ public:
      */
     void draw() const;
 
+    /*! @brief Draws many copies of the Mesh in one call.
+     *
+     *  Every Instance is drawn with the current model matrix, after applying
+     *  its own offset and scale. Non-instanced draws see an offset of zero, a
+     *  scale of one, a white color, and an anim of zero.
+     *
+     *  @param instances Instances to draw.
+     */
+    void drawInstanced(const std::vector<Instance>& instances) const;
+
+    /*! @brief Gets the number of draw calls made by all Meshes.
+     */
+    static std::uint64_t getDrawCalls();
+
 private:
 #ifndef INU_MESH_FALLBACK
-    class Shared
+    class Part
     {
     public:
-        Shared();
-        ~Shared();
-
-        GLuint vertexBuffer;
-
-        GLuint    pointArray,    pointElements;
-        GLuint     lineArray,     lineElements;
-        GLuint triangleArray, triangleElements;
-
-        int pointCount, lineCount, triangleCount;
+        GLenum mode;
+        GLuint first;
+        GLsizei count;
     };
 
-    std::shared_ptr<Shared> share;
+    std::shared_ptr<MeshArena::Block> block;
+    std::array<Part,3> parts;
+    int numParts;
 #else
     Geometry geo;
 #endif // INU_MESH_FALLBACK
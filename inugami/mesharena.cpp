@@ -0,0 +1,297 @@
+/*******************************************************************************
+ * Inugami - An OpenGL framework designed for rapid game development
+ * Version: 0.2.0
+ * https://github.com/DBRalir/Inugami
+ *
+ * Copyright (c) 2012 Jeramy Harrison <dbralir@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#include "mesharena.hpp"
+
+#include "mathtypes.hpp"
+#include "mesh.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+
+namespace Inugami {
+
+#ifndef INU_MESH_FALLBACK
+
+// First-fit free list over a range of elements.
+class FreeList
+{
+public:
+    FreeList(int n)
+        : ranges{{0, n}}
+    {}
+
+    int alloc(int n)
+    {
+        if (n == 0) return 0;
+
+        for (auto i=ranges.begin(); i!=ranges.end(); ++i)
+        {
+            if (i->second < n) continue;
+            int rval = i->first;
+            i->first  += n;
+            i->second -= n;
+            if (i->second == 0) ranges.erase(i);
+            return rval;
+        }
+        return -1;
+    }
+
+    void free(int off, int n)
+    {
+        if (n == 0) return;
+
+        auto i = std::lower_bound(ranges.begin(), ranges.end(), std::make_pair(off, 0));
+        i = ranges.insert(i, {off, n});
+
+        auto next = std::next(i);
+        if (next != ranges.end() && i->first+i->second == next->first)
+        {
+            i->second += next->second;
+            ranges.erase(next);
+        }
+
+        if (i != ranges.begin())
+        {
+            auto prev = std::prev(i);
+            if (prev->first+prev->second == i->first)
+            {
+                prev->second += i->second;
+                ranges.erase(i);
+            }
+        }
+    }
+
+private:
+    std::vector<std::pair<int,int>> ranges;
+};
+
+class MeshArena::Page
+{
+public:
+    Page(int nv, int ni)
+        : vertexBuffer(0)
+        , elementBuffer(0)
+        , vertexArray(0)
+        , instanceBuffer(0)
+        , instanceArray(0)
+        , instanceCapacity(0)
+        , vertexSpace(nv)
+        , indexSpace(ni)
+    {
+        glGenBuffers(1, &vertexBuffer);
+        glGenBuffers(1, &elementBuffer);
+        glGenVertexArrays(1, &vertexArray);
+
+        bindVertexArray(vertexArray);
+
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(Geometry::Vertex)*nv, nullptr, GL_STATIC_DRAW);
+        setVertexPointers();
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBuffer);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint)*ni, nullptr, GL_STATIC_DRAW);
+    }
+
+    ~Page()
+    {
+        if (instanceArray != 0)
+        {
+            forgetVertexArray(instanceArray);
+            glDeleteVertexArrays(1, &instanceArray);
+            glDeleteBuffers(1, &instanceBuffer);
+        }
+
+        forgetVertexArray(vertexArray);
+        glDeleteVertexArrays(1, &vertexArray);
+        glDeleteBuffers(1, &elementBuffer);
+        glDeleteBuffers(1, &vertexBuffer);
+    }
+
+    void setVertexPointers()
+    {
+        glEnableVertexAttribArray(0);
+        glEnableVertexAttribArray(1);
+        glEnableVertexAttribArray(2);
+
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Geometry::Vertex), reinterpret_cast<GLvoid*>(0));
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Geometry::Vertex), reinterpret_cast<GLvoid*>(sizeof(Vec3)));
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Geometry::Vertex), reinterpret_cast<GLvoid*>(sizeof(Vec3)*2));
+    }
+
+    void initInstanceArray()
+    {
+        using Instance = Mesh::Instance;
+
+        glGenBuffers(1, &instanceBuffer);
+        glGenVertexArrays(1, &instanceArray);
+
+        bindVertexArray(instanceArray);
+
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+        setVertexPointers();
+
+        glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+        glEnableVertexAttribArray(3);
+        glEnableVertexAttribArray(4);
+        glEnableVertexAttribArray(5);
+        glEnableVertexAttribArray(6);
+
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Instance), reinterpret_cast<GLvoid*>(offsetof(Instance, offset)));
+        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Instance), reinterpret_cast<GLvoid*>(offsetof(Instance, scale)));
+        glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), reinterpret_cast<GLvoid*>(offsetof(Instance, color)));
+        glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), reinterpret_cast<GLvoid*>(offsetof(Instance, anim)));
+
+        glVertexAttribDivisor(3, 1);
+        glVertexAttribDivisor(4, 1);
+        glVertexAttribDivisor(5, 1);
+        glVertexAttribDivisor(6, 1);
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBuffer);
+    }
+
+    GLuint vertexBuffer;
+    GLuint elementBuffer;
+    GLuint vertexArray;
+
+    GLuint instanceBuffer;
+    GLuint instanceArray;
+    std::size_t instanceCapacity;
+
+    FreeList vertexSpace;
+    FreeList indexSpace;
+};
+
+static std::vector<std::weak_ptr<MeshArena::Page>> pages;
+static GLuint boundArray = 0;
+
+MeshArena::Block::Block(const std::shared_ptr<Page>& p, int bv, int vc, int fi, int ic)
+    : page(p)
+    , baseVertex(bv)
+    , vertexCount(vc)
+    , firstIndex(fi)
+    , indexCount(ic)
+{}
+
+MeshArena::Block::~Block()
+{
+    page->vertexSpace.free(baseVertex, vertexCount);
+    page->indexSpace.free(firstIndex, indexCount);
+}
+
+std::shared_ptr<MeshArena::Block> MeshArena::allocate(const std::vector<Geometry::Vertex>& vertices, const std::vector<GLuint>& indices) //static
+{
+    const int nv = vertices.size();
+    const int ni = indices.size();
+
+    std::shared_ptr<Page> page;
+    int bv = -1;
+    int fi = -1;
+
+    pages.erase(std::remove_if(pages.begin(), pages.end(), [](const std::weak_ptr<Page>& p){return p.expired();}), pages.end());
+
+    for (auto& wp : pages)
+    {
+        page = wp.lock();
+
+        bv = page->vertexSpace.alloc(nv);
+        if (bv < 0) continue;
+
+        fi = page->indexSpace.alloc(ni);
+        if (fi >= 0) break;
+
+        page->vertexSpace.free(bv, nv);
+        bv = -1;
+    }
+
+    if (bv < 0 || fi < 0)
+    {
+        page = std::make_shared<Page>(std::max(nv, int(PAGE_VERTICES)), std::max(ni, int(PAGE_INDICES)));
+        pages.push_back(page);
+        bv = page->vertexSpace.alloc(nv);
+        fi = page->indexSpace.alloc(ni);
+    }
+
+    // Binding the page's own vertex array keeps the element buffer binding of
+    // other vertex arrays intact.
+    bindVertexArray(page->vertexArray);
+
+    if (nv > 0)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, page->vertexBuffer);
+        glBufferSubData(GL_ARRAY_BUFFER, sizeof(Geometry::Vertex)*bv, sizeof(Geometry::Vertex)*nv, &vertices[0]);
+    }
+
+    if (ni > 0)
+    {
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, page->elementBuffer);
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint)*fi, sizeof(GLuint)*ni, &indices[0]);
+    }
+
+    return std::make_shared<Block>(page, bv, nv, fi, ni);
+}
+
+void MeshArena::bind(Page& page) //static
+{
+    bindVertexArray(page.vertexArray);
+}
+
+void MeshArena::bindInstanced(Page& page, std::size_t instanceBytes, const void* data) //static
+{
+    if (page.instanceArray == 0) page.initInstanceArray();
+
+    bindVertexArray(page.instanceArray);
+
+    glBindBuffer(GL_ARRAY_BUFFER, page.instanceBuffer);
+
+    if (instanceBytes > page.instanceCapacity)
+    {
+        page.instanceCapacity = instanceBytes;
+        glBufferData(GL_ARRAY_BUFFER, instanceBytes, data, GL_STREAM_DRAW);
+    }
+    else
+    {
+        glBufferSubData(GL_ARRAY_BUFFER, 0, instanceBytes, data);
+    }
+}
+
+void MeshArena::bindVertexArray(GLuint id) //static
+{
+    if (boundArray == id) return;
+    glBindVertexArray(id);
+    boundArray = id;
+}
+
+void MeshArena::forgetVertexArray(GLuint id) //static
+{
+    if (boundArray == id) boundArray = 0;
+}
+
+#endif // INU_MESH_FALLBACK
+
+} // namespace Inugami
@@ -0,0 +1,112 @@
+/*******************************************************************************
+ * Inugami - An OpenGL framework designed for rapid game development
+ * Version: 0.2.0
+ * https://github.com/DBRalir/Inugami
+ *
+ * Copyright (c) 2012 Jeramy Harrison <dbralir@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#ifndef INUGAMI_MESHARENA_H
+#define INUGAMI_MESHARENA_H
+
+#include "inugami.hpp"
+#include "geometry.hpp"
+
+#include "opengl.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace Inugami {
+
+/*! @brief Shared storage for Mesh data.
+ *
+ *  Meshes are suballocated from large pages, each holding one vertex buffer,
+ *  one element buffer, and one vertex array. Drawing any number of meshes
+ *  from the same page needs no buffer or vertex array switches; each mesh is
+ *  drawn with a base-vertex draw into its part of the page.
+ *
+ *  Pages are freed when the last Block allocated from them is released.
+ */
+class MeshArena
+{
+public:
+    static constexpr int PAGE_VERTICES = 1<<16;   //!< Default vertices per page.
+    static constexpr int PAGE_INDICES  = 3<<16;   //!< Default indices per page.
+
+    class Page;
+
+    /*! @brief A range of a page owned by one Mesh.
+     *
+     *  Released back to its page on destruction.
+     */
+    class Block
+    {
+    public:
+        Block(const std::shared_ptr<Page>& p, int bv, int vc, int fi, int ic);
+        ~Block();
+
+        Block(const Block&) = delete;
+        Block& operator=(const Block&) = delete;
+
+        std::shared_ptr<Page> page;
+
+        GLint  baseVertex;
+        int    vertexCount;
+        GLuint firstIndex;
+        int    indexCount;
+    };
+
+    /*! @brief Copies vertex and index data into the arena.
+     *
+     *  @param vertices Vertices of the mesh.
+     *  @param indices Indices of the mesh, relative to its first vertex.
+     *
+     *  @return Block holding the data.
+     */
+    static std::shared_ptr<Block> allocate(const std::vector<Geometry::Vertex>& vertices, const std::vector<GLuint>& indices);
+
+    /*! @brief Binds a page's vertex array for plain draws.
+     */
+    static void bind(Page& page);
+
+    /*! @brief Binds a page's vertex array for instanced draws.
+     *
+     *  The page's instance buffer is left bound to GL_ARRAY_BUFFER, ready to
+     *  receive Mesh::Instance data.
+     */
+    static void bindInstanced(Page& page, std::size_t instanceBytes, const void* data);
+
+    /*! @brief Binds a vertex array, skipping the call if it is already bound.
+     *
+     *  All vertex array binds should go through this function.
+     */
+    static void bindVertexArray(GLuint id);
+
+    /*! @brief Forgets a vertex array that is about to be deleted.
+     */
+    static void forgetVertexArray(GLuint id);
+};
+
+} // namespace Inugami
+
+#endif // INUGAMI_MESHARENA_H
@@ -0,0 +1,401 @@
+/*******************************************************************************
+ * Inugami - An OpenGL framework designed for rapid game development
+ * Version: 0.2.0
+ * https://github.com/DBRalir/Inugami
+ *
+ * Copyright (c) 2012 Jeramy Harrison <dbralir@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#include "metrics.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+#ifdef __unix__
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif // __unix__
+
+namespace Inugami {
+
+namespace {
+
+bool validName(const std::string& name)
+{
+    if (name.empty()) return false;
+
+    for (unsigned i=0; i<name.size(); ++i)
+    {
+        char c = name[i];
+        bool ok = (c>='a' && c<='z') || (c>='A' && c<='Z') || c=='_' || c==':';
+        if (i > 0) ok = ok || (c>='0' && c<='9');
+        if (!ok) return false;
+    }
+
+    return true;
+}
+
+std::string formatValue(double v)
+{
+    if (std::isnan(v)) return "NaN";
+    if (std::isinf(v)) return (v > 0)? "+Inf" : "-Inf";
+
+    std::ostringstream ss;
+    ss.precision(std::numeric_limits<double>::digits10);
+    ss << v;
+    return ss.str();
+}
+
+std::string escapeHelp(const std::string& in)
+{
+    std::string rval;
+    for (char c : in)
+    {
+        if (c == '\\') rval += "\\\\";
+        else if (c == '\n') rval += "\\n";
+        else rval += c;
+    }
+    return rval;
+}
+
+} // namespace
+
+MetricsException::MetricsException(const std::string& what)
+    : err("Metrics Exception: "+what)
+{}
+
+const char* MetricsException::what() const noexcept
+{
+    return err.c_str();
+}
+
+Metrics::Counter::Counter()
+    : value(0)
+{}
+
+void Metrics::Counter::add(std::uint64_t n)
+{
+    value.fetch_add(n, std::memory_order_relaxed);
+}
+
+std::uint64_t Metrics::Counter::get() const
+{
+    return value.load(std::memory_order_relaxed);
+}
+
+Metrics::Gauge::Gauge()
+    : value(0.0)
+{}
+
+void Metrics::Gauge::set(double v)
+{
+    value.store(v, std::memory_order_relaxed);
+}
+
+double Metrics::Gauge::get() const
+{
+    return value.load(std::memory_order_relaxed);
+}
+
+Metrics::Histogram::Histogram(std::vector<double> b)
+    : bounds(std::move(b))
+    , buckets(new std::atomic<std::uint64_t>[bounds.size()+1])
+    , count(0)
+    , sum(0.0)
+{
+    for (unsigned i=0; i<=bounds.size(); ++i) buckets[i].store(0, std::memory_order_relaxed);
+}
+
+void Metrics::Histogram::observe(double v)
+{
+    unsigned i = 0;
+    while (i < bounds.size() && v > bounds[i]) ++i;
+
+    buckets[i].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+
+    double old = sum.load(std::memory_order_relaxed);
+    while (!sum.compare_exchange_weak(old, old+v, std::memory_order_relaxed)) {}
+}
+
+const std::vector<double>& Metrics::Histogram::getBounds() const
+{
+    return bounds;
+}
+
+std::uint64_t Metrics::Histogram::getBucket(int i) const
+{
+    return buckets[i].load(std::memory_order_relaxed);
+}
+
+std::uint64_t Metrics::Histogram::getCount() const
+{
+    return count.load(std::memory_order_relaxed);
+}
+
+double Metrics::Histogram::getSum() const
+{
+    return sum.load(std::memory_order_relaxed);
+}
+
+std::vector<double> Metrics::exponentialBounds(double start, double factor, int n) //static
+{
+    std::vector<double> rval;
+    for (int i=0; i<n; ++i)
+    {
+        rval.push_back(start);
+        start *= factor;
+    }
+    return rval;
+}
+
+Metrics::Entry::Entry()
+    : type(Type::COUNTER)
+    , help()
+    , counter()
+    , gauge()
+    , histogram()
+{}
+
+Metrics::Metrics()
+    : mutex()
+    , entries()
+    , serving(false)
+    , server()
+    , listenSocket(-1)
+    , socketPath()
+{}
+
+Metrics::~Metrics()
+{
+    stop();
+}
+
+auto Metrics::entry(const std::string& name, const std::string& help, Type type) -> Entry&
+{
+    if (!validName(name)) throw MetricsException("Invalid name \""+name+"\"!");
+
+    auto iter = entries.find(name);
+    if (iter != entries.end())
+    {
+        if (iter->second.type != type) throw MetricsException("\""+name+"\" already has another type!");
+        return iter->second;
+    }
+
+    Entry& e = entries[name];
+    e.type = type;
+    e.help = help;
+    return e;
+}
+
+auto Metrics::counter(const std::string& name, const std::string& help) -> Counter&
+{
+    std::lock_guard<std::mutex> lock (mutex);
+    Entry& e = entry(name, help, Type::COUNTER);
+    if (!e.counter) e.counter.reset(new Counter);
+    return *e.counter;
+}
+
+auto Metrics::gauge(const std::string& name, const std::string& help) -> Gauge&
+{
+    std::lock_guard<std::mutex> lock (mutex);
+    Entry& e = entry(name, help, Type::GAUGE);
+    if (!e.gauge) e.gauge.reset(new Gauge);
+    return *e.gauge;
+}
+
+auto Metrics::histogram(const std::string& name, const std::string& help, std::vector<double> bounds) -> Histogram&
+{
+    std::lock_guard<std::mutex> lock (mutex);
+    Entry& e = entry(name, help, Type::HISTOGRAM);
+    if (!e.histogram) e.histogram.reset(new Histogram(std::move(bounds)));
+    return *e.histogram;
+}
+
+void Metrics::write(std::ostream& out)
+{
+    std::lock_guard<std::mutex> lock (mutex);
+
+    for (auto& p : entries)
+    {
+        const std::string& name = p.first;
+        const Entry& e = p.second;
+
+        out << "# HELP " << name << " " << escapeHelp(e.help) << "\n";
+
+        switch (e.type)
+        {
+        case Type::COUNTER:
+            out << "# TYPE " << name << " counter\n";
+            out << name << " " << e.counter->get() << "\n";
+            break;
+
+        case Type::GAUGE:
+            out << "# TYPE " << name << " gauge\n";
+            out << name << " " << formatValue(e.gauge->get()) << "\n";
+            break;
+
+        case Type::HISTOGRAM:
+        {
+            const Histogram& h = *e.histogram;
+            const auto& bounds = h.getBounds();
+
+            out << "# TYPE " << name << " histogram\n";
+
+            // Read the buckets first, so the total is never less than them
+            std::uint64_t cumulative = 0;
+            for (unsigned i=0; i<bounds.size(); ++i)
+            {
+                cumulative += h.getBucket(i);
+                out << name << "_bucket{le=\"" << formatValue(bounds[i]) << "\"} " << cumulative << "\n";
+            }
+            cumulative += h.getBucket(bounds.size());
+
+            out << name << "_bucket{le=\"+Inf\"} " << cumulative << "\n";
+            out << name << "_sum " << formatValue(h.getSum()) << "\n";
+            out << name << "_count " << cumulative << "\n";
+            break;
+        }
+        }
+    }
+}
+
+void Metrics::writeFile(const std::string& filename)
+{
+    const std::string temp = filename + ".tmp";
+
+    {
+        std::ofstream file(temp);
+        if (!file) throw MetricsException("Can't open \""+temp+"\"!");
+        write(file);
+        if (!file) throw MetricsException("Can't write \""+temp+"\"!");
+    }
+
+    if (std::rename(temp.c_str(), filename.c_str()) != 0)
+    {
+        throw MetricsException("Can't replace \""+filename+"\"!");
+    }
+}
+
+#ifdef __unix__
+
+void Metrics::serve(const std::string& path)
+{
+    if (serving) throw MetricsException("Already serving!");
+
+    sockaddr_un addr {};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) throw MetricsException("Socket path too long!");
+    path.copy(addr.sun_path, path.size());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) throw MetricsException("Can't create socket!");
+
+    ::unlink(path.c_str());
+
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(fd, 4) != 0)
+    {
+        ::close(fd);
+        throw MetricsException("Can't listen on \""+path+"\"!");
+    }
+
+    listenSocket = fd;
+    socketPath = path;
+    serving = true;
+    server = std::thread([this]{ serveLoop(); });
+}
+
+void Metrics::stop()
+{
+    if (!serving) return;
+
+    serving = false;
+    server.join();
+
+    ::close(listenSocket);
+    ::unlink(socketPath.c_str());
+    listenSocket = -1;
+}
+
+void Metrics::serveLoop()
+{
+    while (serving)
+    {
+        // Wake up now and then to notice stop()
+        pollfd pfd {listenSocket, POLLIN, 0};
+        if (poll(&pfd, 1, 200) <= 0) continue;
+
+        int client = accept(listenSocket, nullptr, nullptr);
+        if (client < 0) continue;
+
+        // Clients that don't speak HTTP might never send anything
+        std::string request;
+        char buf[512];
+        pfd = {client, POLLIN, 0};
+        while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192)
+        {
+            if (poll(&pfd, 1, 100) <= 0) break;
+            auto n = recv(client, buf, sizeof(buf), 0);
+            if (n <= 0) break;
+            request.append(buf, n);
+        }
+
+        bool http = (request.compare(0, 4, "GET ") == 0);
+
+        std::ostringstream ss;
+        if (http) ss << "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n\r\n";
+        write(ss);
+
+        const std::string body = ss.str();
+        std::size_t sent = 0;
+        while (sent < body.size())
+        {
+            auto n = send(client, body.data()+sent, body.size()-sent, MSG_NOSIGNAL);
+            if (n <= 0) break;
+            sent += n;
+        }
+
+        ::close(client);
+    }
+}
+
+#else
+
+void Metrics::serve(const std::string&)
+{
+    throw MetricsException("Unix sockets are not supported!");
+}
+
+void Metrics::stop()
+{}
+
+void Metrics::serveLoop()
+{}
+
+#endif // __unix__
+
+} // namespace Inugami
@@ -0,0 +1,259 @@
+/*******************************************************************************
+ * Inugami - An OpenGL framework designed for rapid game development
+ * Version: 0.2.0
+ * https://github.com/DBRalir/Inugami
+ *
+ * Copyright (c) 2012 Jeramy Harrison <dbralir@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#ifndef INUGAMI_METRICS_H
+#define INUGAMI_METRICS_H
+
+#include "exception.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Inugami {
+
+class MetricsException
+    : public Exception
+{
+public:
+    MetricsException(const std::string& what);
+    virtual const char* what() const noexcept override;
+    std::string err;
+};
+
+/*! @brief Metrics registry.
+ *
+ *  Holds named counters, gauges, and histograms that can be updated from any
+ *  thread without locking, and exports them in the Prometheus text
+ *  exposition format.
+ *
+ *  Metrics are never removed, so references to them stay valid for the life
+ *  of the registry.
+ */
+class Metrics
+{
+public:
+
+    /*! @brief Monotonic counter.
+     */
+    class Counter
+    {
+    public:
+        Counter();
+
+        /*! @brief Adds to the counter.
+         */
+        void add(std::uint64_t n = 1);
+
+        /*! @brief Gets the current value.
+         */
+        std::uint64_t get() const;
+
+    private:
+        std::atomic<std::uint64_t> value;
+    };
+
+    /*! @brief Value that can go up and down.
+     */
+    class Gauge
+    {
+    public:
+        Gauge();
+
+        /*! @brief Sets the value.
+         */
+        void set(double v);
+
+        /*! @brief Gets the current value.
+         */
+        double get() const;
+
+    private:
+        std::atomic<double> value;
+    };
+
+    /*! @brief Histogram with fixed buckets.
+     */
+    class Histogram
+    {
+    public:
+        /*! @brief Primary constructor.
+         *
+         *  @param bounds Inclusive upper bounds of the buckets, ascending. A
+         *  bucket for everything larger is always added.
+         */
+        explicit Histogram(std::vector<double> bounds);
+
+        /*! @brief Records a value.
+         */
+        void observe(double v);
+
+        /*! @brief Gets the bucket upper bounds.
+         */
+        const std::vector<double>& getBounds() const;
+
+        /*! @brief Gets the number of values in a bucket.
+         *
+         *  Bucket getBounds().size() holds values above every bound.
+         */
+        std::uint64_t getBucket(int i) const;
+
+        /*! @brief Gets the number of values recorded.
+         */
+        std::uint64_t getCount() const;
+
+        /*! @brief Gets the sum of the values recorded.
+         */
+        double getSum() const;
+
+    private:
+        const std::vector<double> bounds;
+        std::unique_ptr<std::atomic<std::uint64_t>[]> buckets;
+        std::atomic<std::uint64_t> count;
+        std::atomic<double> sum;
+    };
+
+    /*! @brief Makes exponentially spaced bucket bounds.
+     *
+     *  @param start First bound.
+     *  @param factor Ratio between bounds.
+     *  @param n Number of bounds.
+     */
+    static std::vector<double> exponentialBounds(double start, double factor, int n);
+
+    /*! @brief Default constructor.
+     */
+    Metrics();
+
+    Metrics(const Metrics&) = delete;
+    Metrics& operator=(const Metrics&) = delete;
+
+    /*! @brief Destructor.
+     *
+     *  Stops serving, if needed.
+     */
+    ~Metrics();
+
+    /*! @brief Gets or creates a Counter.
+     *
+     *  @param name Metric name, like "game_frames_total".
+     *  @param help Description of the metric.
+     *
+     *  @throws MetricsException if the name is invalid or used by another
+     *  kind of metric.
+     */
+    Counter& counter(const std::string& name, const std::string& help);
+
+    /*! @brief Gets or creates a Gauge.
+     *
+     *  @see counter()
+     */
+    Gauge& gauge(const std::string& name, const std::string& help);
+
+    /*! @brief Gets or creates a Histogram.
+     *
+     *  The bounds are ignored if the Histogram already exists.
+     *
+     *  @see counter()
+     */
+    Histogram& histogram(const std::string& name, const std::string& help, std::vector<double> bounds);
+
+    /*! @brief Writes every metric.
+     *
+     *  @param out Stream to write the Prometheus text format to.
+     */
+    void write(std::ostream& out);
+
+    /*! @brief Writes every metric to a file.
+     *
+     *  The file is written next to its destination and then renamed, so
+     *  readers like the node_exporter textfile collector never see it half
+     *  written.
+     *
+     *  @param filename File to replace.
+     *
+     *  @throws MetricsException if the file can't be written.
+     */
+    void writeFile(const std::string& filename);
+
+    /*! @brief Serves metrics on a Unix socket.
+     *
+     *  A background thread answers every connection with the current
+     *  metrics. Connections that send an HTTP GET get an HTTP response, so
+     *  both `curl --unix-socket` and plain `socat` work.
+     *
+     *  @param path Socket path. An existing file there is replaced.
+     *
+     *  @throws MetricsException if the socket can't be opened, already
+     *  serving, or on platforms without Unix sockets.
+     */
+    void serve(const std::string& path);
+
+    /*! @brief Stops serving.
+     */
+    void stop();
+
+private:
+    enum class Type
+    {
+          COUNTER
+        , GAUGE
+        , HISTOGRAM
+    };
+
+    struct Entry
+    {
+        Type type;
+        std::string help;
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Gauge> gauge;
+        std::unique_ptr<Histogram> histogram;
+
+        Entry();
+    };
+
+    Entry& entry(const std::string& name, const std::string& help, Type type);
+    void serveLoop();
+
+    std::mutex mutex;
+    std::map<std::string, Entry> entries;
+
+    std::atomic<bool> serving;
+    std::thread server;
+    int listenSocket;
+    std::string socketPath;
+};
+
+} // namespace Inugami
+
+#endif // INUGAMI_METRICS_H
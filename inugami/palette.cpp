@@ -0,0 +1,59 @@
+/*******************************************************************************
+ * Inugami - An OpenGL framework designed for rapid game development
+ * Version: 0.2.0
+ * https://github.com/DBRalir/Inugami
+ *
+ * Copyright (c) 2012 Jeramy Harrison <dbralir@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#include "palette.hpp"
+
+namespace Inugami {
+
+Palette::Palette(const std::vector<Image::Pixel>& in)
+    : colors()
+    , white(Image(1, 1), false, false)
+{
+    colors.reserve(in.size());
+
+    for (const Image::Pixel& p : in)
+    {
+        colors.push_back(Vec4{p[0]/255.f, p[1]/255.f, p[2]/255.f, p[3]/255.f});
+    }
+}
+
+void Palette::bind(unsigned int slot) const
+{
+    white.bind(slot);
+}
+
+const Vec4& Palette::operator[](int i) const
+{
+    return colors[i];
+}
+
+int Palette::size() const
+{
+    return colors.size();
+}
+
+} // namespace Inugami
@@ -0,0 +1,86 @@
+/*******************************************************************************
+ * Inugami - An OpenGL framework designed for rapid game development
+ * Version: 0.2.0
+ * https://github.com/DBRalir/Inugami
+ *
+ * Copyright (c) 2012 Jeramy Harrison <dbralir@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#ifndef INUGAMI_PALETTE_H
+#define INUGAMI_PALETTE_H
+
+#include "inugami.hpp"
+
+#include "image.hpp"
+#include "mathtypes.hpp"
+#include "texture.hpp"
+
+#include <vector>
+
+namespace Inugami {
+
+/*! @brief Indexed set of flat colors.
+ *
+ *  A Palette replaces a texture per color. Bind the palette once, then give
+ *  each Mesh::Instance its color from the palette; every color shares the
+ *  same texture, so batches are never broken up by texture switches.
+ */
+class Palette
+{
+public:
+    Palette() = delete;
+
+    /*! @brief Primary constructor.
+     *
+     *  @param in Colors, in index order.
+     */
+    Palette(const std::vector<Image::Pixel>& in);
+
+    /*! @brief Binds the palette's texture.
+     *
+     *  The texture is a single white texel, so drawn colors come entirely
+     *  from the instance color.
+     *
+     *  @param slot Texture slot to bind.
+     */
+    void bind(unsigned int slot) const;
+
+    /*! @brief Gets a color.
+     *
+     *  @param i Color index.
+     *
+     *  @return Color as normalized RGBA.
+     */
+    const Vec4& operator[](int i) const;
+
+    /*! @brief Number of colors.
+     */
+    int size() const;
+
+private:
+    std::vector<Vec4> colors;
+    Texture white;
+};
+
+} // namespace Inugami
+
+#endif // INUGAMI_PALETTE_H
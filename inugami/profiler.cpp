@@ -27,20 +27,266 @@
 
 #include "profiler.hpp"
 
-#include "opengl.hpp"
-
-#include <limits>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
 #include <functional>
+#include <iomanip>
+#include <iterator>
+#include <limits>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define INU_PROFILER_TSC
+#endif
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define INU_PROFILER_PERF
+#endif
 
 namespace Inugami {
 
+namespace {
+
+using SteadyClock = std::chrono::steady_clock;
+
+inline std::uint64_t ticks()
+{
+#ifdef INU_PROFILER_TSC
+    return __rdtsc();
+#else
+    return SteadyClock::now().time_since_epoch().count();
+#endif
+}
+
+struct ZoneRegistry
+{
+    std::mutex mutex;
+    std::vector<std::string> names;
+    std::vector<bool> histograms;
+    std::unordered_map<std::string, int> ids;
+
+    ZoneRegistry()
+        : mutex()
+        , names()
+        , histograms()
+        , ids()
+    {}
+};
+
+std::atomic<unsigned> profilerSerial (0);
+
+void closeCounters(int (&fds)[Profiler::COUNTERS])
+{
+    for (int& fd : fds)
+    {
+#ifdef INU_PROFILER_PERF
+        if (fd >= 0) close(fd);
+#endif // INU_PROFILER_PERF
+        fd = -1;
+    }
+}
+
+// Opens the counters of the calling thread as one group, so that they are
+// scheduled and read together. Leaves every fd at -1 on failure.
+bool openCounters(int (&fds)[Profiler::COUNTERS])
+{
+    std::fill(std::begin(fds), std::end(fds), -1);
+
+#ifdef INU_PROFILER_PERF
+    static const std::uint64_t configs[Profiler::COUNTERS] =
+    {
+          PERF_COUNT_HW_CPU_CYCLES
+        , PERF_COUNT_HW_INSTRUCTIONS
+        , PERF_COUNT_HW_CACHE_REFERENCES
+        , PERF_COUNT_HW_CACHE_MISSES
+        , PERF_COUNT_HW_BRANCH_INSTRUCTIONS
+        , PERF_COUNT_HW_BRANCH_MISSES
+    };
+
+    for (int i=0; i<Profiler::COUNTERS; ++i)
+    {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = configs[i];
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        attr.exclude_kernel = 1; // Allowed with the default perf_event_paranoid
+        attr.exclude_hv = 1;
+
+        int group = (i == 0)? -1 : fds[0];
+        fds[i] = syscall(__NR_perf_event_open, &attr, 0, -1, group, PERF_FLAG_FD_CLOEXEC);
+
+        if (fds[i] < 0)
+        {
+            closeCounters(fds);
+            return false;
+        }
+    }
+
+    return true;
+#else
+    return false;
+#endif // INU_PROFILER_PERF
+}
+
+ZoneRegistry& zoneRegistry()
+{
+    static ZoneRegistry reg;
+    return reg;
+}
+
+int internZone(const std::string& name, bool histogram)
+{
+    auto& reg = zoneRegistry();
+    std::lock_guard<std::mutex> lock (reg.mutex);
+
+    auto iter = reg.ids.find(name);
+    if (iter != reg.ids.end())
+    {
+        if (histogram) reg.histograms[iter->second] = true;
+        return iter->second;
+    }
+
+    int id = reg.names.size();
+    reg.names.push_back(name);
+    reg.histograms.push_back(histogram);
+    reg.ids[name] = id;
+    return id;
+}
+
+bool zoneHistogram(int id)
+{
+    auto& reg = zoneRegistry();
+    std::lock_guard<std::mutex> lock (reg.mutex);
+    return reg.histograms[id];
+}
+
+} // namespace
+
+Profiler::Zone::Zone(const std::string& name, bool histogram)
+    : id(internZone(name, histogram))
+{}
+
+std::string Profiler::Zone::getName() const
+{
+    auto& reg = zoneRegistry();
+    std::lock_guard<std::mutex> lock (reg.mutex);
+    return reg.names[id];
+}
+
+Profiler::Histogram::Histogram()
+    : buckets()
+    , count(0)
+{}
+
+Profiler::Allocs::Allocs()
+    : count(0)
+    , bytes(0)
+    , frees(0)
+{}
+
+Profiler::Node::Node()
+    : zone(-1)
+    , parent(-1)
+    , count(0)
+    , total(0)
+    , min(std::numeric_limits<std::uint64_t>::max())
+    , max(0)
+    , histogram()
+    , allocs()
+    , counted(0)
+    , counters()
+{}
+
+int Profiler::Histogram::bucketOf(std::uint64_t value) //static
+{
+    if (value < std::uint64_t(SUB_BUCKETS)) return value;
+
+#ifdef __GNUC__
+    int e = 63 - __builtin_clzll(value);
+#else
+    int e = SUB_BITS;
+    while (value >> (e+1)) ++e;
+#endif
+
+    int sub = int(value >> (e-SUB_BITS)) - SUB_BUCKETS;
+    return (e-SUB_BITS+1)*SUB_BUCKETS + sub;
+}
+
+std::uint64_t Profiler::Histogram::lowerBound(int bucket) //static
+{
+    if (bucket < SUB_BUCKETS) return bucket;
+
+    int k = bucket/SUB_BUCKETS;
+    std::uint64_t sub = SUB_BUCKETS + bucket%SUB_BUCKETS;
+    return sub << (k-1);
+}
+
+std::uint64_t Profiler::Histogram::width(int bucket) //static
+{
+    if (bucket < SUB_BUCKETS) return 1;
+    return std::uint64_t(1) << (bucket/SUB_BUCKETS - 1);
+}
+
+void Profiler::Histogram::add(int bucket, std::uint64_t n)
+{
+    if (n == 0) return;
+    if (buckets.empty()) buckets.resize(BUCKETS, 0);
+    buckets[bucket] += n;
+    count += n;
+}
+
+void Profiler::Histogram::merge(const Histogram& other)
+{
+    for (int i=0; i<int(other.buckets.size()); ++i) add(i, other.buckets[i]);
+}
+
+std::uint64_t Profiler::Histogram::getCount() const
+{
+    return count;
+}
+
+std::uint64_t Profiler::Histogram::quantile(double q) const
+{
+    if (count == 0) return 0;
+
+    std::uint64_t target = std::ceil(q*count);
+    if (target < 1) target = 1;
+    if (target > count) target = count;
+
+    std::uint64_t seen = 0;
+    for (int i=0; i<BUCKETS; ++i)
+    {
+        seen += buckets[i];
+        if (seen >= target) return lowerBound(i) + (width(i)-1)/2;
+    }
+
+    return 0;
+}
+
 Profiler::Profile::Profile()
     : min(std::numeric_limits<double>::max())
     , max(std::numeric_limits<double>::min())
     , average(0.0)
-    , samples(0.0)
-    , start(0.0)
+    , samples(0)
+    , allocations(0)
+    , allocatedBytes(0)
+    , deallocations(0)
+    , counted(0)
+    , counters()
     , children()
+    , histogram()
+    , secondsPerTick(0.0)
 {}
 
 ConstMap<Profiler::Profile::PMap> Profiler::Profile::getChildren() const
@@ -48,60 +294,777 @@ ConstMap<Profiler::Profile::PMap> Profiler::Profile::getChildren() const
     return children;
 }
 
-void Profiler::start(const std::string& in)
+bool Profiler::Profile::hasHistogram() const
+{
+    return histogram.getCount() > 0;
+}
+
+auto Profiler::Profile::getHistogram() const -> const Histogram&
 {
-    if (current.begin() != current.end())
+    return histogram;
+}
+
+double Profiler::Profile::percentile(double p) const
+{
+    if (!hasHistogram()) return 0.0;
+
+    // The bucket middle can fall outside of what was actually seen
+    double rval = histogram.quantile(p/100.0) * secondsPerTick;
+    return std::min(std::max(rval, min), max);
+}
+
+bool Profiler::Profile::hasCounters() const
+{
+    return counted > 0;
+}
+
+double Profiler::Profile::getIPC() const
+{
+    if (counters[CYCLES] == 0) return 0.0;
+    return double(counters[INSTRUCTIONS])/counters[CYCLES];
+}
+
+double Profiler::Profile::getCacheMissRate() const
+{
+    if (counters[CACHE_REFERENCES] == 0) return 0.0;
+    return double(counters[CACHE_MISSES])/counters[CACHE_REFERENCES];
+}
+
+double Profiler::Profile::getBranchMissRate() const
+{
+    if (counters[BRANCHES] == 0) return 0.0;
+    return double(counters[BRANCH_MISSES])/counters[BRANCHES];
+}
+
+struct Profiler::Merged
+{
+    std::uint64_t count;
+    std::uint64_t total;
+    std::uint64_t min;
+    std::uint64_t max;
+    std::uint64_t allocs;
+    std::uint64_t allocBytes;
+    std::uint64_t frees;
+    std::uint64_t counted;
+    std::uint64_t counters[COUNTERS];
+    Histogram histogram;
+    std::map<int, Merged> children;
+
+    Merged()
+        : count(0)
+        , total(0)
+        , min(std::numeric_limits<std::uint64_t>::max())
+        , max(0)
+        , allocs(0)
+        , allocBytes(0)
+        , frees(0)
+        , counted(0)
+        , counters()
+        , histogram()
+        , children()
+    {}
+};
+
+Profiler::ThreadData::ThreadData()
+    : thread()
+    , retired(false)
+    , size(0)
+    , ring(nullptr)
+    , ringSize(0)
+    , claimed(0)
+    , written(0)
+    , children()
+    , stack()
+    , countersOpened(false)
+    , counterFds()
+    , chunks()
+    , ringStorage()
+{
+    std::fill(std::begin(counterFds), std::end(counterFds), -1);
+    addNode(-1, -1); // Root
+}
+
+void Profiler::ThreadData::retire()
+{
+    // Counters opened by this thread stop counting once it exits
+    closeCounters(counterFds);
+    countersOpened = false;
+    stack.clear();
+
+    retired.store(true, std::memory_order_release);
+}
+
+Profiler::ThreadData::~ThreadData()
+{
+    closeCounters(counterFds);
+}
+
+int Profiler::ThreadData::addNode(int zone, int parent)
+{
+    int i = size.load(std::memory_order_relaxed);
+
+    if (i == CHUNK_SIZE*MAX_CHUNKS)
     {
-        auto p = current.back();
-        auto&& c = p->children[in];
-        if (!c) c.reset(new Profile);
-        current.push_back(c);
-        c->start = glfwGetTime();
+        throw std::length_error("Too many profiles!");
     }
-    else
+
+    auto& chunk = chunks[i/CHUNK_SIZE];
+    if (!chunk) chunk.reset(new Node[CHUNK_SIZE]);
+
+    Node& n = chunk[i%CHUNK_SIZE];
+    n.zone = zone;
+    n.parent = parent;
+    n.count.store(0, std::memory_order_relaxed);
+    n.total.store(0, std::memory_order_relaxed);
+    n.min.store(std::numeric_limits<std::uint64_t>::max(), std::memory_order_relaxed);
+    n.max.store(0, std::memory_order_relaxed);
+    n.allocs.count.store(0, std::memory_order_relaxed);
+    n.allocs.bytes.store(0, std::memory_order_relaxed);
+    n.allocs.frees.store(0, std::memory_order_relaxed);
+    n.counted.store(0, std::memory_order_relaxed);
+    for (auto& c : n.counters) c.store(0, std::memory_order_relaxed);
+
+    if (zone >= 0 && zoneHistogram(zone))
     {
-        auto&& p = profiles[in];
-        if (!p) p.reset(new Profile);
-        current.push_back(p);
-        p->start = glfwGetTime();
+        n.histogram.reset(new std::atomic<std::uint64_t>[Histogram::BUCKETS]);
+        for (int b=0; b<Histogram::BUCKETS; ++b)
+        {
+            n.histogram[b].store(0, std::memory_order_relaxed);
+        }
     }
+
+    children.emplace_back();
+
+    size.store(i+1, std::memory_order_release);
+
+    return i;
 }
 
-void Profiler::stop()
+auto Profiler::ThreadData::node(int i) -> Node&
+{
+    return chunks[i/CHUNK_SIZE][i%CHUNK_SIZE];
+}
+
+void Profiler::ThreadData::record(int zone, std::uint64_t start, std::uint64_t end, std::size_t capacity)
 {
-    if (current.begin() != current.end())
+    constexpr auto relaxed = std::memory_order_relaxed;
+
+    Event* events = ring.load(relaxed);
+    if (!events)
     {
-        Profile& p = *current.back();
-        double dur = glfwGetTime() - p.start;
-        if (dur < p.min) p.min = dur;
-        if (dur > p.max) p.max = dur;
-        p.average = (p.average * p.samples + dur) / (p.samples + 1.0);
-        p.samples += 1.0;
-        current.pop_back();
+        ringStorage.reset(new Event[capacity]);
+        ringSize = capacity;
+        events = ringStorage.get();
+        ring.store(events, std::memory_order_release);
     }
-    else
+
+    std::uint64_t w = written.load(relaxed);
+    Event& e = events[w%ringSize];
+
+    // Readers that see any part of the new Event will also see the claim
+    claimed.store(w+1, relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    e.zone.store(zone, relaxed);
+    e.start.store(start, relaxed);
+    e.end.store(end, relaxed);
+
+    written.store(w+1, std::memory_order_release);
+}
+
+bool Profiler::ThreadData::readCounters(CounterSample& out)
+{
+#ifdef INU_PROFILER_PERF
+    if (counterFds[0] < 0) return false;
+
+    // Number of counters, then the sample
+    struct
+    {
+        std::uint64_t nr;
+        CounterSample sample;
+    } buf;
+
+    if (read(counterFds[0], &buf, sizeof(buf)) != ssize_t(sizeof(buf))) return false;
+
+    out = buf.sample;
+    return true;
+#else
+    return false;
+#endif // INU_PROFILER_PERF
+}
+
+Profiler::Profiler()
+    : serial(++profilerSerial)
+    , traceSize(0)
+    , traceRequested(false)
+    , counting(false)
+    , mutex()
+    , threads()
+    , profiles()
+    , threadProfiles()
+    , tickBase(ticks())
+    , timeBase(SteadyClock::now())
+{}
+
+void Profiler::start(const Zone& zone)
+{
+#ifdef INU_TRACK_ALLOCS
+    // The profiler's own allocations aren't counted
+    currentAllocs = nullptr;
+#endif // INU_TRACK_ALLOCS
+
+    ThreadData& data = local();
+
+    int parent = (data.stack.empty())? 0 : data.stack.back().node;
+
+    auto& children = data.children[parent];
+    if (int(children.size()) <= zone.id) children.resize(zone.id+1, -1);
+
+    int node = children[zone.id];
+
+    if (node < 0)
+    {
+        node = data.addNode(zone.id, parent);
+        data.children[parent][zone.id] = node;
+    }
+
+    Active active;
+    active.node = node;
+
+    if (counting.load(std::memory_order_relaxed) && !data.countersOpened)
+    {
+        data.countersOpened = true;
+        openCounters(data.counterFds);
+    }
+
+    // Read last, so the read isn't counted or timed
+    active.counted = counting.load(std::memory_order_relaxed) && data.readCounters(active.counters);
+    active.start = ticks();
+
+    data.stack.push_back(active);
+
+#ifdef INU_TRACK_ALLOCS
+    currentAllocs = &data.node(node).allocs;
+#endif // INU_TRACK_ALLOCS
+}
+
+void Profiler::start(const std::string& in)
+{
+    start(Zone(in));
+}
+
+void Profiler::stop()
+{
+    std::uint64_t end = ticks();
+
+#ifdef INU_TRACK_ALLOCS
+    currentAllocs = nullptr;
+#endif // INU_TRACK_ALLOCS
+
+    ThreadData& data = local();
+
+    if (data.stack.empty())
     {
         throw std::logic_error("No active profile!");
     }
+
+    const Active& active = data.stack.back();
+
+    CounterSample sample;
+    bool counted = active.counted && data.readCounters(sample);
+
+    // Only this thread writes, so plain loads and stores are enough
+    constexpr auto relaxed = std::memory_order_relaxed;
+    Node& n = data.node(active.node);
+    std::uint64_t dur = end - active.start;
+    n.total.store(n.total.load(relaxed) + dur, relaxed);
+    if (dur < n.min.load(relaxed)) n.min.store(dur, relaxed);
+    if (dur > n.max.load(relaxed)) n.max.store(dur, relaxed);
+    if (n.histogram)
+    {
+        auto& bucket = n.histogram[Histogram::bucketOf(dur)];
+        bucket.store(bucket.load(relaxed) + 1, relaxed);
+    }
+    n.count.store(n.count.load(relaxed) + 1, relaxed);
+
+    // Scaled up for the time the group was multiplexed off of the PMU
+    const CounterSample& begin = active.counters;
+    if (counted && sample.running > begin.running)
+    {
+        double scale = double(sample.enabled-begin.enabled) / (sample.running-begin.running);
+        for (int i=0; i<COUNTERS; ++i)
+        {
+            auto delta = std::uint64_t((sample.values[i]-begin.values[i])*scale);
+            n.counters[i].store(n.counters[i].load(relaxed) + delta, relaxed);
+        }
+        n.counted.store(n.counted.load(relaxed) + 1, relaxed);
+    }
+
+    if (std::size_t capacity = traceSize.load(relaxed))
+    {
+        data.record(n.zone, active.start, end, capacity);
+    }
+
+    data.stack.pop_back();
+
+#ifdef INU_TRACK_ALLOCS
+    if (!data.stack.empty()) currentAllocs = &data.node(data.stack.back().node).allocs;
+#endif // INU_TRACK_ALLOCS
 }
 
 auto Profiler::getAll() -> ConstMap<PMap>
 {
+    const double spt = secondsPerTick();
+
+    std::lock_guard<std::mutex> lock (mutex);
+
+    Merged root;
+    for (auto& data : threads) collect(*data, root);
+
+    profiles.clear();
+    toProfiles(root, profiles, spt);
+
     return ConstMap<PMap>(profiles);
 }
 
+auto Profiler::getThreads() -> ConstMap<PMap>
+{
+    const double spt = secondsPerTick();
+
+    std::lock_guard<std::mutex> lock (mutex);
+
+    threadProfiles.clear();
+
+    for (unsigned i=0; i<threads.size(); ++i)
+    {
+        Merged root;
+        collect(*threads[i], root);
+
+        std::ostringstream name;
+        name << "Thread " << std::setw(3) << std::setfill('0') << i
+             << " (" << threads[i]->thread << ")";
+
+        Profile::Ptr p (new Profile);
+        toProfiles(root, p->children, spt);
+        threadProfiles[name.str()] = p;
+    }
+
+    return ConstMap<PMap>(threadProfiles);
+}
+
+void Profiler::setCounters(bool enable)
+{
+    counting.store(enable, std::memory_order_relaxed);
+}
+
+bool Profiler::countersAvailable() //static
+{
+    static const bool available = []
+    {
+        int fds[COUNTERS];
+        bool opened = openCounters(fds);
+        closeCounters(fds);
+        return opened;
+    }();
+
+    return available;
+}
+
+void Profiler::setTracing(std::size_t events)
+{
+    traceSize.store(events, std::memory_order_relaxed);
+}
+
+void Profiler::writeTrace(std::ostream& out)
+{
+    const double spt = secondsPerTick();
+
+    std::lock_guard<std::mutex> lock (mutex);
+
+    std::vector<std::vector<Span>> copies (threads.size());
+
+    for (unsigned i=0; i<threads.size(); ++i)
+    {
+        copies[i] = copyEvents(*threads[i]);
+    }
+
+    auto& reg = zoneRegistry();
+    std::lock_guard<std::mutex> regLock (reg.mutex);
+
+    auto escape = [](const std::string& in)
+    {
+        std::ostringstream ss;
+        for (char c : in)
+        {
+            if (c == '"' || c == '\\') ss << '\\' << c;
+            else if (static_cast<unsigned char>(c) < 0x20)
+            {
+                ss << "\\u" << std::hex << std::setw(4) << std::setfill('0') << int(c) << std::dec;
+            }
+            else ss << c;
+        }
+        return ss.str();
+    };
+
+    const double usPerTick = spt*1e6;
+
+    auto flags = out.flags();
+    auto precision = out.precision();
+    out << std::fixed << std::setprecision(3);
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    bool first = true;
+    for (unsigned i=0; i<copies.size(); ++i)
+    {
+        if (!first) out << ",";
+        first = false;
+
+        out << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << i
+            << ",\"args\":{\"name\":\"Thread " << i << "\"}}";
+
+        for (const Span& c : copies[i])
+        {
+            out << ",\n{\"name\":\"" << escape(reg.names[c.zone])
+                << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << i
+                << ",\"ts\":" << (std::int64_t(c.start-tickBase))*usPerTick
+                << ",\"dur\":" << (c.end-c.start)*usPerTick
+                << "}";
+        }
+    }
+
+    out << "\n]}\n";
+
+    out.flags(flags);
+    out.precision(precision);
+}
+
+void Profiler::requestTrace()
+{
+    traceRequested.store(true, std::memory_order_relaxed);
+}
+
+bool Profiler::takeTraceRequest()
+{
+    return traceRequested.exchange(false, std::memory_order_relaxed);
+}
+
+void Profiler::writeWindow(std::ostream& out, SteadyClock::time_point from, SteadyClock::time_point to, std::thread::id thread)
+{
+    const double spt = secondsPerTick();
+
+    auto toTicks = [&](SteadyClock::time_point t)
+    {
+        return std::uint64_t(std::int64_t(tickBase) + std::llround(std::chrono::duration<double>(t-timeBase).count()/spt));
+    };
+
+    const std::uint64_t begin = toTicks(from);
+    const std::uint64_t end = toTicks(to);
+
+    std::vector<Span> spans;
+    {
+        std::lock_guard<std::mutex> lock (mutex);
+        for (auto& data : threads)
+        {
+            if (data->thread == thread && !data->retired.load(std::memory_order_acquire)) spans = copyEvents(*data);
+        }
+    }
+
+    spans.erase(std::remove_if(spans.begin(), spans.end(), [&](const Span& s)
+    {
+        return s.end < begin || s.start > end;
+    }), spans.end());
+
+    // Parents are recorded after their children, so put them back in front
+    std::sort(spans.begin(), spans.end(), [](const Span& a, const Span& b)
+    {
+        return (a.start != b.start)? a.start < b.start : a.end > b.end;
+    });
+
+    auto& reg = zoneRegistry();
+    std::lock_guard<std::mutex> regLock (reg.mutex);
+
+    auto flags = out.flags();
+    auto precision = out.precision();
+    out << std::fixed << std::setprecision(3);
+
+    std::vector<std::uint64_t> parents;
+    for (const Span& s : spans)
+    {
+        while (!parents.empty() && (s.start >= parents.back() || s.end > parents.back()))
+        {
+            parents.pop_back();
+        }
+
+        out << std::string(parents.size(), '\t') << reg.names[s.zone] << ": "
+            << (s.end-s.start)*spt*1e3 << " ms\n";
+
+        parents.push_back(s.end);
+    }
+
+    out.flags(flags);
+    out.precision(precision);
+}
+
+auto Profiler::copyEvents(ThreadData& data) -> std::vector<Span>
+{
+    constexpr auto relaxed = std::memory_order_relaxed;
+
+    std::vector<Span> copy;
+
+    Event* events = data.ring.load(std::memory_order_acquire);
+    if (!events) return copy;
+
+    std::uint64_t end = data.written.load(std::memory_order_acquire);
+    std::uint64_t begin = (end > data.ringSize)? end-data.ringSize : 0;
+
+    for (std::uint64_t e=begin; e<end; ++e)
+    {
+        const Event& ev = events[e%data.ringSize];
+        copy.push_back({ev.zone.load(relaxed), ev.start.load(relaxed), ev.end.load(relaxed)});
+    }
+
+    // Drop whatever the owner started overwriting while we were copying
+    std::atomic_thread_fence(std::memory_order_acquire);
+    std::uint64_t claimed = data.claimed.load(relaxed);
+    std::uint64_t valid = (claimed > data.ringSize)? claimed-data.ringSize : 0;
+    if (valid > begin)
+    {
+        copy.erase(copy.begin(), copy.begin()+std::min<std::uint64_t>(valid-begin, copy.size()));
+    }
+
+    return copy;
+}
+
+// The ThreadData of one thread in each Profiler it has used. Shared with the
+// Profilers, so either side can go away first.
+struct Profiler::Owner
+{
+    struct Entry
+    {
+        unsigned serial;
+        std::shared_ptr<ThreadData> data;
+    };
+
+    Owner()
+        : entries()
+    {}
+
+    ~Owner()
+    {
+        for (auto& e : entries) e.data->retire();
+    }
+
+    std::vector<Entry> entries;
+};
+
+auto Profiler::owner() -> Owner& //static
+{
+    thread_local Owner rval;
+    return rval;
+}
+
+auto Profiler::local() -> ThreadData&
+{
+    // Cached per thread, keyed by serial so a new Profiler at the same
+    // address is never mistaken for an old one
+    thread_local struct { unsigned serial; ThreadData* data; } cache {0, nullptr};
+
+    if (cache.serial != serial)
+    {
+        auto& entries = owner().entries;
+
+        ThreadData* found = nullptr;
+        for (auto& e : entries)
+        {
+            if (e.serial == serial) found = e.data.get();
+        }
+
+        if (!found)
+        {
+            // Entries of destroyed Profilers are only held here
+            entries.erase(std::remove_if(entries.begin(), entries.end(), [](const Owner::Entry& e)
+            {
+                return e.data.use_count() == 1;
+            }), entries.end());
+
+            std::shared_ptr<ThreadData> data;
+            {
+                std::lock_guard<std::mutex> lock (mutex);
+
+                // Take over the data of a thread that has exited, so that
+                // short-lived threads don't grow the Profiler without bound
+                for (auto& d : threads)
+                {
+                    if (d->retired.exchange(false, std::memory_order_acq_rel))
+                    {
+                        data = d;
+                        break;
+                    }
+                }
+
+                if (!data)
+                {
+                    data = std::make_shared<ThreadData>();
+                    threads.push_back(data);
+                }
+
+                data->thread = std::this_thread::get_id();
+            }
+
+            entries.push_back({serial, data});
+            found = data.get();
+        }
+
+        cache.serial = serial;
+        cache.data = found;
+    }
+
+    return *cache.data;
+}
+
+void Profiler::collect(ThreadData& data, Merged& root)
+{
+    // Stats of a Profile being stopped right now may be partially updated
+    constexpr auto relaxed = std::memory_order_relaxed;
+    int size = data.size.load(std::memory_order_acquire);
+
+    // Parents are always created before their children
+    std::vector<Merged*> merged (size, nullptr);
+    merged[0] = &root;
+
+    for (int i=1; i<size; ++i)
+    {
+        const Node& n = data.node(i);
+        Merged& m = merged[n.parent]->children[n.zone];
+
+        std::uint64_t count = n.count.load(relaxed);
+        if (count > 0)
+        {
+            m.count += count;
+            m.total += n.total.load(relaxed);
+            m.min = std::min(m.min, n.min.load(relaxed));
+            m.max = std::max(m.max, n.max.load(relaxed));
+
+            if (n.histogram)
+            {
+                for (int b=0; b<Histogram::BUCKETS; ++b)
+                {
+                    m.histogram.add(b, n.histogram[b].load(relaxed));
+                }
+            }
+        }
+
+        m.allocs += n.allocs.count.load(relaxed);
+        m.allocBytes += n.allocs.bytes.load(relaxed);
+        m.frees += n.allocs.frees.load(relaxed);
+
+        m.counted += n.counted.load(relaxed);
+        for (int c=0; c<COUNTERS; ++c) m.counters[c] += n.counters[c].load(relaxed);
+
+        merged[i] = &m;
+    }
+}
+
+void Profiler::toProfiles(const Merged& in, PMap& out, double spt)
+{
+    auto& reg = zoneRegistry();
+    std::lock_guard<std::mutex> lock (reg.mutex);
+
+    std::function<void(const Merged&, PMap&)> build;
+    build = [&](const Merged& m, PMap& dest)
+    {
+        for (auto& c : m.children)
+        {
+            const Merged& n = c.second;
+
+            Profile::Ptr p (new Profile);
+            if (n.count > 0)
+            {
+                p->min = n.min*spt;
+                p->max = n.max*spt;
+                p->average = (double(n.total)/n.count)*spt;
+                p->samples = n.count;
+                p->histogram = n.histogram;
+                p->secondsPerTick = spt;
+            }
+            p->allocations = n.allocs;
+            p->allocatedBytes = n.allocBytes;
+            p->deallocations = n.frees;
+            p->counted = n.counted;
+            std::copy(std::begin(n.counters), std::end(n.counters), p->counters);
+            build(n, p->children);
+
+            dest[reg.names[c.first]] = p;
+        }
+    };
+
+    build(in, out);
+}
+
+double Profiler::secondsPerTick()
+{
+#ifdef INU_PROFILER_TSC
+    // Calibrate the timestamp counter against the steady clock
+    auto elapsed = SteadyClock::now() - timeBase;
+    if (elapsed < std::chrono::milliseconds(10))
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10) - elapsed);
+    }
+
+    std::uint64_t tickNow = ticks();
+    auto timeNow = SteadyClock::now();
+
+    return std::chrono::duration<double>(timeNow - timeBase).count() / (tickNow - tickBase);
+#else
+    return double(SteadyClock::period::num) / SteadyClock::period::den;
+#endif
+}
+
+thread_local Profiler::Allocs* Profiler::currentAllocs = nullptr;
+
+void Profiler::countAllocation(std::size_t bytes) //static
+{
+    // Only the thread that owns the Profile writes to it
+    constexpr auto relaxed = std::memory_order_relaxed;
+    if (Allocs* a = currentAllocs)
+    {
+        a->count.store(a->count.load(relaxed) + 1, relaxed);
+        a->bytes.store(a->bytes.load(relaxed) + bytes, relaxed);
+    }
+}
+
+void Profiler::countDeallocation() //static
+{
+    constexpr auto relaxed = std::memory_order_relaxed;
+    if (Allocs* a = currentAllocs)
+    {
+        a->frees.store(a->frees.load(relaxed) + 1, relaxed);
+    }
+}
+
+ScopedProfile::ScopedProfile(Profiler& in, const Profiler::Zone& zone)
+    : profiler(in)
+{
+    profiler.start(zone);
+}
+
+ScopedProfile::ScopedProfile(Profiler* in, const Profiler::Zone& zone)
+    : profiler(*in)
+{
+    profiler.start(zone);
+}
+
 ScopedProfile::ScopedProfile(Profiler& in, const std::string& str)
     : profiler(in)
-    , name(str)
 {
-    profiler.start(name);
+    profiler.start(str);
 }
 
 ScopedProfile::ScopedProfile(Profiler* in, const std::string& str)
     : profiler(*in)
-    , name(str)
 {
-    profiler.start(name);
+    profiler.start(str);
 }
 
 ScopedProfile::~ScopedProfile()
@@ -110,3 +1073,98 @@ ScopedProfile::~ScopedProfile()
 }
 
 } // namespace Inugami
+
+#ifdef INU_TRACK_ALLOCS
+
+namespace {
+
+void* trackedAlloc(std::size_t n)
+{
+    if (n == 0) n = 1;
+
+    void* rval;
+    while (!(rval = std::malloc(n)))
+    {
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) throw std::bad_alloc();
+        handler();
+    }
+
+    Inugami::Profiler::countAllocation(n);
+    return rval;
+}
+
+void* trackedAllocNoThrow(std::size_t n) noexcept
+{
+    try
+    {
+        return trackedAlloc(n);
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+void trackedFree(void* p) noexcept
+{
+    if (!p) return;
+    Inugami::Profiler::countDeallocation();
+    std::free(p);
+}
+
+} // namespace
+
+void* operator new(std::size_t n)
+{
+    return trackedAlloc(n);
+}
+
+void* operator new[](std::size_t n)
+{
+    return trackedAlloc(n);
+}
+
+void* operator new(std::size_t n, const std::nothrow_t&) noexcept
+{
+    return trackedAllocNoThrow(n);
+}
+
+void* operator new[](std::size_t n, const std::nothrow_t&) noexcept
+{
+    return trackedAllocNoThrow(n);
+}
+
+void operator delete(void* p) noexcept
+{
+    trackedFree(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    trackedFree(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+    trackedFree(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+    trackedFree(p);
+}
+
+#ifdef __cpp_sized_deallocation
+void operator delete(void* p, std::size_t) noexcept
+{
+    trackedFree(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+    trackedFree(p);
+}
+#endif // __cpp_sized_deallocation
+
+#endif // INU_TRACK_ALLOCS
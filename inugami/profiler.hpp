@@ -30,9 +30,15 @@
 
 #include "utility.hpp"
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <map>
+#include <ostream>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 namespace Inugami {
@@ -41,11 +47,123 @@ namespace Inugami {
  *
  *  This class is an automatic nesting profiler. It can be used for high-
  *  precision timing for use in tracking down bottlenecks.
+ *
+ *  Durations are measured in CPU timestamp ticks where available, falling
+ *  back to std::chrono::steady_clock, and accumulated in a flat array. No
+ *  windowing library is needed, so tools without a Core can use it too.
+ *
+ *  Each thread records into its own tree, so starting and stopping a Profile
+ *  never takes a lock. The trees are merged when a report is requested.
+ *
+ *  When built with INU_TRACK_ALLOCS, the global operator new and delete are
+ *  replaced, and every allocation is counted against the innermost active
+ *  Profile of the thread that made it.
  */
 class Profiler
 {
 public:
 
+    /*! @brief Interned Profile name.
+     *
+     *  Zones are meant to be created once, as statics, so that starting a
+     *  Profile never has to look up its name:
+     *
+     *  @code
+     *  static const Profiler::Zone zone ("Update");
+     *  ScopedProfile prof(profiler, zone);
+     *  @endcode
+     */
+    class Zone
+    {
+    public:
+        /*! @brief Primary constructor.
+         *
+         *  Zones with the same name share the same ID. If any of them asks
+         *  for a Histogram, Profile%s of that name started afterwards will
+         *  record one.
+         *
+         *  @param name Name of the Profile.
+         *  @param histogram Record a Histogram of durations.
+         */
+        explicit Zone(const std::string& name, bool histogram = false);
+
+        /*! @brief Gets the name of the Zone.
+         */
+        std::string getName() const;
+
+        const int id; //!< Index of this Zone.
+    };
+
+    /*! @brief Log-bucketed histogram.
+     *
+     *  Each power of two is split into SUB_BUCKETS linear buckets, so a
+     *  value is never more than 1/16 away from where it is reported.
+     *  Histograms can be merged, as long as they hold the same units.
+     */
+    class Histogram
+    {
+    public:
+        static constexpr int SUB_BITS = 4;
+        static constexpr int SUB_BUCKETS = 1<<SUB_BITS;
+        static constexpr int BUCKETS = (65-SUB_BITS)*SUB_BUCKETS;
+
+        /*! @brief Default constructor.
+         *
+         *  Buckets are not allocated until something is added.
+         */
+        Histogram();
+
+        /*! @brief Gets the bucket that holds a value.
+         */
+        static int bucketOf(std::uint64_t value);
+
+        /*! @brief Gets the smallest value held by a bucket.
+         */
+        static std::uint64_t lowerBound(int bucket);
+
+        /*! @brief Gets the number of values held by a bucket.
+         */
+        static std::uint64_t width(int bucket);
+
+        /*! @brief Adds samples to a bucket.
+         */
+        void add(int bucket, std::uint64_t n);
+
+        /*! @brief Adds every sample of another Histogram.
+         */
+        void merge(const Histogram& other);
+
+        /*! @brief Gets the number of samples.
+         */
+        std::uint64_t getCount() const;
+
+        /*! @brief Gets a quantile.
+         *
+         *  @param q Quantile, between 0 and 1.
+         *
+         *  @return Middle of the bucket the quantile falls in, or 0 if the
+         *  Histogram is empty.
+         */
+        std::uint64_t quantile(double q) const;
+
+    private:
+        std::vector<std::uint64_t> buckets;
+        std::uint64_t count;
+    };
+
+    /*! @brief Hardware events counted by setCounters().
+     */
+    enum Counter
+    {
+          CYCLES           //!< CPU cycles.
+        , INSTRUCTIONS     //!< Instructions retired.
+        , CACHE_REFERENCES //!< Last level cache accesses.
+        , CACHE_MISSES     //!< Last level cache misses.
+        , BRANCHES         //!< Branch instructions retired.
+        , BRANCH_MISSES    //!< Mispredicted branches.
+        , COUNTERS         //!< Number of Counters.
+    };
+
     /*! @brief Profile data.
      */
     class Profile
@@ -58,27 +176,86 @@ public:
 
         Profile();
 
-        double min;     //!< Minimum duration.
-        double max;     //!< Maximum duration.
-        double average; //!< Average duration.
-        double samples; //!< Number of durations recorded.
+        double min;            //!< Minimum duration.
+        double max;            //!< Maximum duration.
+        double average;        //!< Average duration.
+        std::uint64_t samples; //!< Number of durations recorded.
+
+        // Made directly in this Profile, not in its children, see Profiler
+        std::uint64_t allocations;    //!< Allocations made.
+        std::uint64_t allocatedBytes; //!< Bytes allocated.
+        std::uint64_t deallocations;  //!< Deallocations made.
+
+        // Made in this Profile and its children, see setCounters()
+        std::uint64_t counted;            //!< Number of durations counted.
+        std::uint64_t counters[COUNTERS]; //!< Events counted, by Counter.
 
         ConstMap<PMap> getChildren() const;
 
+        /*! @brief Checks if hardware events were counted.
+         */
+        bool hasCounters() const;
+
+        /*! @brief Gets the instructions retired per cycle.
+         */
+        double getIPC() const;
+
+        /*! @brief Gets the fraction of cache references that missed.
+         */
+        double getCacheMissRate() const;
+
+        /*! @brief Gets the fraction of branches that were mispredicted.
+         */
+        double getBranchMissRate() const;
+
+        /*! @brief Checks if a Histogram was recorded.
+         */
+        bool hasHistogram() const;
+
+        /*! @brief Gets the Histogram of durations, in ticks.
+         */
+        const Histogram& getHistogram() const;
+
+        /*! @brief Gets a percentile of the durations.
+         *
+         *  Needs a Histogram, see Zone.
+         *
+         *  @param p Percentile, between 0 and 100.
+         *
+         *  @return Duration, or 0 if no Histogram was recorded.
+         */
+        double percentile(double p) const;
+
     private:
-        double start;
         PMap children;
+        Histogram histogram;
+        double secondsPerTick;
     };
 
     /*! @brief Map of names to Profile%s.
      */
     using PMap = Profile::PMap;
 
+    /*! @brief Default constructor.
+     */
+    Profiler();
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
     /*! @brief Start the specified Profile.
      *
      *  Starts the given Profile. If another Profile is already active, the
      *  given Profile is nested inside of the active Profile.
      *
+     *  @param zone Zone of the Profile to start.
+     */
+    void start(const Zone& zone);
+
+    /*! @brief Start the specified Profile.
+     *
+     *  Interns the name on every call. Prefer start(const Zone&).
+     *
      *  @param in Name of the Profile to start.
      */
     void start(const std::string& in);
@@ -91,14 +268,235 @@ public:
     void stop();
 
     /*! @brief Gets the top-level profiles.
+     *
+     *  Builds a snapshot of everything recorded so far, with the trees of
+     *  all threads merged together.
      *
      *  @return Top-level profiles.
      */
     ConstMap<PMap> getAll();
 
+    /*! @brief Gets the profiles of each thread.
+     *
+     *  Builds a snapshot of everything recorded so far. Each entry is named
+     *  after a thread, in the order they first used this Profiler, and its
+     *  children are the top-level profiles of that thread.
+     *
+     *  Once a thread exits, its entry is taken over by the next thread that
+     *  starts using this Profiler, so short-lived threads share entries.
+     *
+     *  @return Profiles by thread.
+     */
+    ConstMap<PMap> getThreads();
+
+    /*! @brief Records individual Profile%s for a trace.
+     *
+     *  Each thread keeps its most recent Profile%s in a ring buffer, which is
+     *  allocated the first time that thread stops a Profile while tracing.
+     *  The size of a buffer never changes once it is allocated.
+     *
+     *  @param events Profiles kept per thread, or 0 to stop recording.
+     */
+    void setTracing(std::size_t events);
+
+    /*! @brief Writes the recorded trace.
+     *
+     *  The trace is in the Chrome trace event JSON format, which can be
+     *  opened in chrome://tracing or Perfetto.
+     *
+     *  @param out Stream to write to.
+     */
+    void writeTrace(std::ostream& out);
+
+    /*! @brief Asks for a trace to be written.
+     *
+     *  This is safe to call from a signal handler. Whoever owns the Profiler
+     *  should check takeTraceRequest() periodically.
+     */
+    void requestTrace();
+
+    /*! @brief Checks for and clears a trace request.
+     *
+     *  @return True if requestTrace() was called since the last check.
+     */
+    bool takeTraceRequest();
+
+    /*! @brief Writes the recorded Profile%s of one thread in a time window.
+     *
+     *  Each recorded Profile that overlaps the window is written on its own
+     *  line, indented under the Profile it was nested in, with its duration
+     *  in milliseconds. Only Profiles kept by setTracing() can be written.
+     *
+     *  @param out Stream to write to.
+     *  @param from Start of the window.
+     *  @param to End of the window.
+     *  @param thread Thread to write.
+     */
+    void writeWindow(std::ostream& out, std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to, std::thread::id thread = std::this_thread::get_id());
+
+    /*! @brief Counts hardware events in each Profile.
+     *
+     *  Uses perf_event_open() on Linux. Each thread opens its counters the
+     *  first time it starts a Profile while counting. Profiles on threads
+     *  that can't open them, or on other systems, are timed as usual but not
+     *  counted. Reading the counters costs a system call at each start and
+     *  stop.
+     *
+     *  @param enable Count Profiles started from now on.
+     */
+    void setCounters(bool enable);
+
+    /*! @brief Checks if hardware events can be counted.
+     *
+     *  @return True if the calling thread could open the counters.
+     */
+    static bool countersAvailable();
+
+    /*! @brief Checks if allocations are being counted.
+     *
+     *  @return True if built with INU_TRACK_ALLOCS.
+     */
+    static constexpr bool tracksAllocations()
+    {
+#ifdef INU_TRACK_ALLOCS
+        return true;
+#else
+        return false;
+#endif // INU_TRACK_ALLOCS
+    }
+
+    /*! @brief Counts an allocation against the active Profile.
+     *
+     *  Called by the replacement operator new.
+     */
+    static void countAllocation(std::size_t bytes);
+
+    /*! @brief Counts a deallocation against the active Profile.
+     *
+     *  Called by the replacement operator delete.
+     */
+    static void countDeallocation();
+
 private:
+    // Written only by the thread that allocates
+    struct Allocs
+    {
+        std::atomic<std::uint64_t> count;
+        std::atomic<std::uint64_t> bytes;
+        std::atomic<std::uint64_t> frees;
+
+        Allocs();
+    };
+
+    static thread_local Allocs* currentAllocs;
+
+    // Written only by the owning thread, read by the collector
+    struct Node
+    {
+        int zone;
+        int parent;
+        std::atomic<std::uint64_t> count;
+        std::atomic<std::uint64_t> total;
+        std::atomic<std::uint64_t> min;
+        std::atomic<std::uint64_t> max;
+        std::unique_ptr<std::atomic<std::uint64_t>[]> histogram;
+        Allocs allocs;
+        std::atomic<std::uint64_t> counted;
+        std::atomic<std::uint64_t> counters[COUNTERS];
+
+        Node();
+    };
+
+    // Raw group read, times are how long the counters were enabled and
+    // actually running on the PMU
+    struct CounterSample
+    {
+        std::uint64_t enabled;
+        std::uint64_t running;
+        std::uint64_t values[COUNTERS];
+    };
+
+    struct Active
+    {
+        int node;
+        std::uint64_t start;
+        bool counted;
+        CounterSample counters;
+    };
+
+    struct Event
+    {
+        std::atomic<int> zone;
+        std::atomic<std::uint64_t> start;
+        std::atomic<std::uint64_t> end;
+    };
+
+    struct Span
+    {
+        int zone;
+        std::uint64_t start;
+        std::uint64_t end;
+    };
+
+    class ThreadData
+    {
+    public:
+        static constexpr int CHUNK_SIZE = 64;
+        static constexpr int MAX_CHUNKS = 1024;
+
+        ThreadData();
+        ~ThreadData();
+
+        int addNode(int zone, int parent);
+        Node& node(int i);
+        void record(int zone, std::uint64_t start, std::uint64_t end, std::size_t capacity);
+        bool readCounters(CounterSample& out);
+        void retire();
+
+        std::thread::id thread; // Guarded by the Profiler's mutex
+        std::atomic<bool> retired; // Set with release once the owner exits
+        std::atomic<int> size; // Published with release after adding a Node
+
+        std::atomic<Event*> ring; // Published with release once allocated
+        std::size_t ringSize;
+        std::atomic<std::uint64_t> claimed; // Bumped before an Event is overwritten
+        std::atomic<std::uint64_t> written; // Bumped after an Event is complete
+
+        // Owning thread only
+        std::vector<std::vector<int>> children; // Node index per Zone ID, or -1
+        std::vector<Active> stack;
+        bool countersOpened;
+        int counterFds[COUNTERS]; // Group leader first, or -1
+
+    private:
+        std::unique_ptr<Node[]> chunks[MAX_CHUNKS];
+        std::unique_ptr<Event[]> ringStorage;
+    };
+
+    struct Merged;
+    struct Owner;
+
+    static Owner& owner();
+
+    ThreadData& local();
+    std::vector<Span> copyEvents(ThreadData& data);
+    void collect(ThreadData& data, Merged& root);
+    void toProfiles(const Merged& in, PMap& out, double spt);
+    double secondsPerTick();
+
+    const unsigned serial;
+
+    std::atomic<std::size_t> traceSize;
+    std::atomic<bool> traceRequested;
+    std::atomic<bool> counting;
+
+    std::mutex mutex; // Guards threads and the reports, never the hot path
+    std::vector<std::shared_ptr<ThreadData>> threads;
     PMap profiles;
-    std::vector<Profile::Ptr> current;
+    PMap threadProfiles;
+
+    std::uint64_t tickBase;
+    std::chrono::steady_clock::time_point timeBase;
 };
 
 /*! @brief Automatic profile manager.
@@ -112,6 +510,24 @@ public:
     ScopedProfile() = delete;
     ScopedProfile(const ScopedProfile&) = delete;
 
+    /*! @brief Reference constructor.
+     *
+     *  Starts the Profiler::Profile for the Zone in the given Profiler.
+     *
+     *  @param in Profiler.
+     *  @param zone Zone of Profiler::Profile.
+     */
+    ScopedProfile(Profiler& in, const Profiler::Zone& zone);
+
+    /*! @brief Pointer constructor.
+     *
+     *  Starts the Profiler::Profile for the Zone in the given Profiler.
+     *
+     *  @param in Profiler.
+     *  @param zone Zone of Profiler::Profile.
+     */
+    ScopedProfile(Profiler* in, const Profiler::Zone& zone);
+
     /*! @brief Reference constructor.
      *
      *  Starts the named Profiler::Profile in the given Profiler.
@@ -138,7 +554,6 @@ public:
 
 private:
     Profiler& profiler;
-    std::string name;
 };
 
 } // namespace Inugami
@@ -31,6 +31,7 @@
 #include "shaderprogram.hpp"
 
 #include <array>
+#include <cstring>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -72,11 +73,42 @@ ShaderUniformException::ShaderUniformException(const std::string &name)
     err = ss.str();
 }
 
+Shader::UniformID::UniformID()
+    : index(-1)
+{}
+
+Shader::UniformID::UniformID(int i)
+    : index(i)
+{}
+
+bool Shader::UniformID::valid() const
+{
+    return (index >= 0);
+}
+
+Shader::Uniform::Uniform()
+    : name()
+    , type(0)
+    , size(0)
+    , location(-1)
+    , value()
+    , hasValue(false)
+{}
+
+bool Shader::Uniform::update(const void* val, std::size_t bytes)
+{
+    if (hasValue && std::memcmp(&value[0], val, bytes) == 0) return false;
+    std::memcpy(&value[0], val, bytes);
+    hasValue = true;
+    return true;
+}
+
 #ifndef INU_NO_SHADERS
 
 Shader::Shared::Shared()
     : program(glCreateProgram())
     , uniforms()
+    , ids()
 {}
 
 Shader::Shared::~Shared()
@@ -164,21 +196,43 @@ void Shader::initUniforms()
     glGetProgramiv(share->program, GL_ACTIVE_UNIFORMS, &numUniforms);
     glGetProgramiv(share->program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
 
-    GLchar* name = new GLchar[maxLength];
+    std::vector<GLchar> name (maxLength);
     Uniform tmpUniform;
     for (int i=0; i<numUniforms; ++i)
     {
-        glGetActiveUniform(share->program, i, maxLength, nullptr, &tmpUniform.size, &tmpUniform.type, name);
-        tmpUniform.location = glGetUniformLocation(share->program, name);
-        share->uniforms[name] = tmpUniform;
+        glGetActiveUniform(share->program, i, maxLength, nullptr, &tmpUniform.size, &tmpUniform.type, &name[0]);
+        tmpUniform.location = glGetUniformLocation(share->program, &name[0]);
+
+        // Members of uniform blocks are set through buffers
+        if (tmpUniform.location < 0) continue;
+
+        tmpUniform.name = &name[0];
+        share->ids[tmpUniform.name] = share->uniforms.size();
+        share->uniforms.push_back(tmpUniform);
     }
 }
 
-const Shader::Uniform* Shader::getUniform(const std::string& name) const
+Shader::UniformID Shader::getUniformID(const std::string& name) const
+{
+    if (!share) return UniformID();
+    auto iter = share->ids.find(name);
+    if (iter == share->ids.end()) return UniformID();
+    return UniformID(iter->second);
+}
+
+bool Shader::bindBlock(const std::string& name, GLuint binding) const
+{
+    if (!share) return false;
+    GLuint index = glGetUniformBlockIndex(share->program, name.c_str());
+    if (index == GL_INVALID_INDEX) return false;
+    glUniformBlockBinding(share->program, index, binding);
+    return true;
+}
+
+Shader::Uniform* Shader::getUniform(UniformID id) const
 {
-    auto iter = share->uniforms.find(name);
-    if (iter == share->uniforms.end()) return nullptr;
-    return &iter->second;
+    if (!share || !id.valid()) return nullptr;
+    return &share->uniforms[id.index];
 }
 
 #else
@@ -186,6 +240,7 @@ const Shader::Uniform* Shader::getUniform(const std::string& name) const
 Shader::Shared::Shared()
     : program()
     , uniforms()
+    , ids()
 {}
 
 Shader::Shared::~Shared()
@@ -203,7 +258,17 @@ void Shader::bind() const
 void Shader::initUniforms()
 {}
 
-const Shader::Uniform* Shader::getUniform(const std::string& name) const
+Shader::UniformID Shader::getUniformID(const std::string&) const
+{
+    return UniformID();
+}
+
+bool Shader::bindBlock(const std::string&, GLuint) const
+{
+    return false;
+}
+
+Shader::Uniform* Shader::getUniform(UniformID) const
 {
     return nullptr;
 }
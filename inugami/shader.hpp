@@ -34,10 +34,14 @@
 #include "opengl.hpp"
 #include "utility.hpp"
 
+#include <array>
+#include <cstddef>
 #include <list>
 #include <memory>
 #include <string>
 #include <map>
+#include <utility>
+#include <vector>
 
 namespace Inugami {
 
@@ -82,6 +86,31 @@ class Shader
 {
 
 public:
+    /*! @brief Handle to a uniform variable.
+     *
+     *  Resolved once with getUniformID(), after which setting the uniform does
+     *  not need a name lookup. A UniformID is only meaningful for the Shader
+     *  (or copies of the Shader) that created it.
+     */
+    class UniformID
+    {
+        friend class Shader;
+    public:
+        /*! @brief Default constructor.
+         *
+         *  Refers to no uniform; setting it does nothing.
+         */
+        UniformID();
+
+        /*! @brief True if the uniform exists in the shader.
+         */
+        bool valid() const;
+
+    private:
+        explicit UniformID(int i);
+        int index;
+    };
+
     /*! @brief Default constructor.
      */
     Shader() = default;
@@ -100,6 +129,37 @@ public:
      */
     void bind() const;
 
+    /*! @brief Looks up a uniform variable.
+     *
+     *  @param name Name of uniform.
+     *
+     *  @return Handle to the uniform, invalid if the shader has no such
+     *  uniform.
+     */
+    UniformID getUniformID(const std::string& name) const;
+
+    /*! @brief Binds a uniform block to a buffer binding point.
+     *
+     *  @param name Name of the uniform block.
+     *  @param binding Binding point.
+     *
+     *  @return False if the shader has no such block.
+     */
+    bool bindBlock(const std::string& name, GLuint binding) const;
+
+    /*! @brief Sets a uniform variable in the shader.
+     *
+     *  The shader must be bound. Values equal to the last value set are not
+     *  uploaded again.
+     *
+     *  @param id Handle to the uniform.
+     *  @param val Value to upload.
+     *
+     *  @return False if @a id does not refer to a uniform.
+     */
+    template <typename T>
+    bool setUniform(UniformID id, T&& val) const;
+
     /*! @brief Sets a uniform variable in the shader.
      *
      *  @param name Name of uniform.
@@ -111,9 +171,19 @@ public:
 private:
     struct Uniform
     {
+        using Value = std::array<unsigned char, sizeof(glm::mat4)>;
+
+        Uniform();
+
+        std::string name;
         GLenum type;
         GLint size;
         GLint location;
+
+        Value value;
+        bool hasValue;
+
+        bool update(const void* val, std::size_t bytes);
     };
 
     class Shared
@@ -122,44 +192,56 @@ private:
         Shared();
         ~Shared();
         GLuint program;
-        std::map<std::string,Uniform> uniforms;
+        std::vector<Uniform> uniforms;
+        std::map<std::string,int> ids;
     };
 
+    template <typename T>
+    static bool accepts(GLenum type);
+
     void initUniforms();
-    const Uniform* getUniform(const std::string& name) const;
+    Uniform* getUniform(UniformID id) const;
 
     std::shared_ptr<Shared> share;
 };
 
 template <typename T>
-inline bool Shader::setUniform(const std::string& name, T&& val) const
+inline bool Shader::accepts(GLenum type)
 {
-    using GT = GLType<typename std::decay<T>::type>;
-    const Uniform* uni = getUniform(name);
-    if (!uni) return false;
-    if (uni->type != GT::value) throw ShaderUniformException(name);
-    GT::uniformFunc(uni->location, val);
-    return true;
+    return (type == GLType<T>::value);
 }
 
 template <>
-inline bool Shader::setUniform<int>(const std::string& name, int&& val) const
+inline bool Shader::accepts<int>(GLenum type)
+{
+    return (    type == GLType<int>::value
+            ||  type == GL_SAMPLER_1D
+            ||  type == GL_SAMPLER_2D
+            ||  type == GL_SAMPLER_3D
+            ||  type == GL_SAMPLER_CUBE
+            ||  type == GL_SAMPLER_1D_SHADOW
+            ||  type == GL_SAMPLER_2D_SHADOW
+    );
+}
+
+template <typename T>
+inline bool Shader::setUniform(UniformID id, T&& val) const
 {
-    using GT = GLType<int>;
-    const Uniform* uni = getUniform(name);
+    using V = typename std::decay<T>::type;
+    static_assert(sizeof(V) <= sizeof(Uniform::Value), "Uniform type too large!");
+    Uniform* uni = getUniform(id);
     if (!uni) return false;
-    if (    uni->type != GT::value
-        &&  uni->type != GL_SAMPLER_1D
-        &&  uni->type != GL_SAMPLER_2D
-        &&  uni->type != GL_SAMPLER_3D
-        &&  uni->type != GL_SAMPLER_CUBE
-        &&  uni->type != GL_SAMPLER_1D_SHADOW
-        &&  uni->type != GL_SAMPLER_2D_SHADOW
-    ) throw ShaderUniformException(name);
-    GT::uniformFunc(uni->location, val);
+    if (!accepts<V>(uni->type)) throw ShaderUniformException(uni->name);
+    if (uni->update(&val, sizeof(V))) GLType<V>::uniformFunc(uni->location, val);
     return true;
 }
 
+template <typename T>
+inline bool Shader::setUniform(const std::string& name, T&& val) const
+{
+    return setUniform(getUniformID(name), std::forward<T>(val));
+}
+
 } // namespace Inugami
 
 #endif // INUGAMI_SHADER_H
@@ -47,16 +47,21 @@ ShaderProgram ShaderProgram::fromDefault() //static
         "layout (location = 0) in vec3 VertexPosition;\n"
         "layout (location = 1) in vec3 VertexNormal;\n"
         "layout (location = 2) in vec2 VertexTexCoord;\n"
+        "layout (location = 3) in vec3 InstanceOffset;\n"
+        "layout (location = 4) in vec3 InstanceScale;\n"
+        "layout (location = 5) in vec4 InstanceColor;\n"
         "uniform mat4 MVP;\n"
         "out vec3 Position;\n"
         "out vec3 Normal;\n"
         "out vec2 TexCoord;\n"
+        "out vec4 Tint;\n"
         "void main()\n"
         "{\n"
         "    TexCoord = VertexTexCoord;\n"
         "    Normal = normalize(VertexNormal);\n"
-        "    Position = VertexPosition;\n"
-        "    gl_Position = MVP * vec4(VertexPosition,1.0);\n"
+        "    Position = VertexPosition*InstanceScale+InstanceOffset;\n"
+        "    Tint = InstanceColor;\n"
+        "    gl_Position = MVP * vec4(Position,1.0);\n"
         "}\n"
     ;
     rval.sources[FRAG] =
@@ -64,10 +69,11 @@ ShaderProgram ShaderProgram::fromDefault() //static
         "in vec3 Position;\n"
         "in vec3 Normal;\n"
         "in vec2 TexCoord;\n"
+        "in vec4 Tint;\n"
         "uniform sampler2D Tex0;\n"
         "out vec4 FragColor;\n"
         "void main() {\n"
-        "    vec4 texColor = texture( Tex0, TexCoord );\n"
+        "    vec4 texColor = texture( Tex0, TexCoord ) * Tint;\n"
         "    FragColor = texColor;\n"
         "}\n"
     ;
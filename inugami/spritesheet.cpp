@@ -40,11 +40,21 @@ Spritesheet::Spritesheet(const Image& img, int tw, int th, float cx, float cy)
     : Spritesheet(Texture(img, false, false), tw, th, cx, cy)
 {}
 
+Spritesheet::Tile::Tile()
+    : posMin()
+    , posMax()
+    , texMin()
+    , texMax()
+{}
+
 Spritesheet::Spritesheet(const Texture& in, int tw, int th, float cx, float cy)
     : tilesX(0)
     , tilesY(0)
+    , tileWidth(tw)
+    , tileHeight(th)
     , tex(in)
     , meshes()
+    , center{cx, cy}
 {
     generateMeshes(tw, th, cx, cy);
 }
@@ -55,6 +65,27 @@ void Spritesheet::draw(int r, int c) const
     meshes[r*tilesX+c].draw();
 }
 
+Spritesheet::Tile Spritesheet::getTile(int r, int c) const
+{
+    const float tw = tileWidth;
+    const float th = tileHeight;
+
+    Tile rval;
+
+    rval.posMin = Vec2{-center.x*tw   , -center.y*th   };
+    rval.posMax = Vec2{-center.x*tw+tw, -center.y*th+th};
+
+    rval.texMin = Vec2{float(c  )/float(tilesX), float(tilesY-r-1)/float(tilesY)};
+    rval.texMax = Vec2{float(c+1)/float(tilesX), float(tilesY-r  )/float(tilesY)};
+
+    return rval;
+}
+
+const Texture& Spritesheet::getTexture() const
+{
+    return tex;
+}
+
 void Spritesheet::generateMeshes(int tw, int th, float cx, float cy)
 {
     constexpr float E = 0.0f; // std::numeric_limits<float>::epsilon() * 1.0e4;
@@ -30,6 +30,7 @@
 
 #include "inugami.hpp"
 
+#include "mathtypes.hpp"
 #include "mesh.hpp"
 #include "texture.hpp"
 
@@ -45,6 +46,20 @@ namespace Inugami {
 class Spritesheet
 {
 public:
+    /*! @brief Location of a sprite.
+     *
+     *  Corners of the sprite's quad, relative to its center, and the matching
+     *  texture coordinates.
+     */
+    class Tile
+    {
+    public:
+        Tile(); //!< Default constructor.
+
+        Vec2 posMin, posMax;
+        Vec2 texMin, texMax;
+    };
+
     Spritesheet() = delete;
 
     /*! @brief Raw Image constructor.
@@ -74,14 +89,30 @@ public:
      */
     void draw(int r, int c) const;
 
+    /*! @brief Gets the location of a sprite.
+     *
+     *  @param r Row index of sprite.
+     *  @param c Column index of sprite.
+     *
+     *  @return Quad and texture coordinates of the sprite.
+     */
+    Tile getTile(int r, int c) const;
+
+    /*! @brief Gets the sheet's texture.
+     */
+    const Texture& getTexture() const;
+
     ConstAttr<int,Spritesheet> tilesX;  //!< Number of tile columns.
     ConstAttr<int,Spritesheet> tilesY;  //!< Number of tile rows.
+    ConstAttr<int,Spritesheet> tileWidth;   //!< Width of each tile, in pixels.
+    ConstAttr<int,Spritesheet> tileHeight;  //!< Height of each tile, in pixels.
 
 private:
     void generateMeshes(int tw, int th, float cx, float cy);
 
     Texture tex;
     std::vector<Mesh> meshes;
+    Vec2 center;
 };
 
 } // namespace Inugami
@@ -0,0 +1,183 @@
+/*******************************************************************************
+ * Inugami - An OpenGL framework designed for rapid game development
+ * Version: 0.2.0
+ * https://github.com/DBRalir/Inugami
+ *
+ * Copyright (c) 2012 Jeramy Harrison <dbralir@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#include "textbatch.hpp"
+
+#include "mesharena.hpp"
+
+#include <cstddef>
+
+namespace Inugami {
+
+#ifndef INU_MESH_FALLBACK
+
+TextBatch::Shared::Shared()
+    : vertexBuffer(0)
+    , vertexArray(0)
+    , capacity(0)
+{
+    glGenBuffers(1, &vertexBuffer);
+    glGenVertexArrays(1, &vertexArray);
+
+    MeshArena::bindVertexArray(vertexArray);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Geometry::Vertex), reinterpret_cast<GLvoid*>(0));
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Geometry::Vertex), reinterpret_cast<GLvoid*>(sizeof(Vec3)));
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Geometry::Vertex), reinterpret_cast<GLvoid*>(sizeof(Vec3)*2));
+}
+
+TextBatch::Shared::~Shared()
+{
+    MeshArena::forgetVertexArray(vertexArray);
+    glDeleteVertexArrays(1, &vertexArray);
+    glDeleteBuffers(1, &vertexBuffer);
+}
+
+TextBatch::TextBatch(const Spritesheet& f)
+    : font(&f)
+    , vertices()
+    , share(new Shared)
+{}
+
+#else
+
+TextBatch::TextBatch(const Spritesheet& f)
+    : font(&f)
+    , vertices()
+{}
+
+#endif // INU_MESH_FALLBACK
+
+void TextBatch::clear()
+{
+    vertices.clear();
+}
+
+void TextBatch::add(const Mat4& mat, const std::string& text)
+{
+    const int tilesX = font->tilesX;
+    const int tilesY = font->tilesY;
+    const float advance = font->tileWidth;
+
+    const Vec3 norm = Vec3(mat * Vec4{0.f, 0.f, 1.f, 0.f});
+
+    for (std::size_t i=0; i<text.size(); ++i)
+    {
+        const int ch = static_cast<unsigned char>(text[i]);
+        if (ch/tilesX >= tilesY) continue;
+
+        const Spritesheet::Tile tile = font->getTile(ch/tilesX, ch%tilesX);
+
+        const float x = advance*i;
+
+        auto corner = [&](float px, float py, float tx, float ty)
+        {
+            Geometry::Vertex v;
+            v.pos  = Vec3(mat * Vec4{x+px, py, 0.f, 1.f});
+            v.norm = norm;
+            v.tex  = Vec2{tx, ty};
+            vertices.push_back(v);
+        };
+
+        corner(tile.posMin.x, tile.posMin.y, tile.texMin.x, tile.texMin.y);
+        corner(tile.posMin.x, tile.posMax.y, tile.texMin.x, tile.texMax.y);
+        corner(tile.posMax.x, tile.posMax.y, tile.texMax.x, tile.texMax.y);
+
+        corner(tile.posMin.x, tile.posMin.y, tile.texMin.x, tile.texMin.y);
+        corner(tile.posMax.x, tile.posMin.y, tile.texMax.x, tile.texMin.y);
+        corner(tile.posMax.x, tile.posMax.y, tile.texMax.x, tile.texMax.y);
+    }
+}
+
+#ifndef INU_MESH_FALLBACK
+
+void TextBatch::draw() const
+{
+    if (vertices.empty()) return;
+
+    font->getTexture().bind(0);
+
+    glBindBuffer(GL_ARRAY_BUFFER, share->vertexBuffer);
+
+    const std::size_t bytes = sizeof(Geometry::Vertex)*vertices.size();
+
+    if (vertices.size() > share->capacity)
+    {
+        share->capacity = vertices.size();
+        glBufferData(GL_ARRAY_BUFFER, bytes, &vertices[0], GL_STREAM_DRAW);
+    }
+    else
+    {
+        glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, &vertices[0]);
+    }
+
+    MeshArena::bindVertexArray(share->vertexArray);
+    glDrawArrays(GL_TRIANGLES, 0, vertices.size());
+}
+
+#else
+
+void TextBatch::draw() const
+{
+    font->getTexture().bind(0);
+
+    glBegin(GL_TRIANGLES);
+    for (auto&& v : vertices)
+    {
+        glTexCoord2f(v.tex.x, v.tex.y);
+        glNormal3f(v.norm.x, v.norm.y, v.norm.z);
+        glVertex3f(v.pos.x, v.pos.y, v.pos.z);
+    }
+    glEnd();
+}
+
+#endif // INU_MESH_FALLBACK
+
+NumberText::NumberText(int w)
+    : width(w)
+    , cache()
+{}
+
+const std::string& NumberText::operator()(int val)
+{
+    auto iter = cache.find(val);
+    if (iter != cache.end()) return iter->second;
+
+    // Keep the cache bounded; values still in use are formatted again
+    if (cache.size() >= 1024) cache.clear();
+
+    std::string str = std::to_string(val);
+    if (int(str.size()) < width) str.insert(0, width-str.size(), ' ');
+
+    return cache.emplace(val, std::move(str)).first->second;
+}
+
+} // namespace Inugami
@@ -0,0 +1,133 @@
+/*******************************************************************************
+ * Inugami - An OpenGL framework designed for rapid game development
+ * Version: 0.2.0
+ * https://github.com/DBRalir/Inugami
+ *
+ * Copyright (c) 2012 Jeramy Harrison <dbralir@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#ifndef INUGAMI_TEXTBATCH_H
+#define INUGAMI_TEXTBATCH_H
+
+#include "inugami.hpp"
+#include "geometry.hpp"
+#include "mathtypes.hpp"
+#include "spritesheet.hpp"
+
+#include "opengl.hpp"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Inugami {
+
+/*! @brief Batched text renderer.
+ *
+ *  Collects glyphs from a Spritesheet font into a single vertex buffer so that
+ *  any amount of text can be drawn with one texture bind and one draw call.
+ *  Glyphs are transformed on the CPU, so draw() should be called with an
+ *  identity model matrix.
+ *
+ *  Glyph @a ch is taken from row @a ch/tilesX and column @a ch%tilesX of the
+ *  font.
+ */
+class TextBatch
+{
+    TextBatch() = delete;
+public:
+    /*! @brief Primary constructor.
+     *
+     *  @param font Spritesheet to take glyphs from.
+     */
+    TextBatch(const Spritesheet& font);
+
+    TextBatch(const TextBatch&) = delete;
+    TextBatch& operator=(const TextBatch&) = delete;
+
+    /*! @brief Removes all queued text.
+     */
+    void clear();
+
+    /*! @brief Queues a string.
+     *
+     *  Each glyph is advanced by one tile width from the last.
+     *
+     *  @param mat Transform of the first glyph.
+     *  @param text Text to queue.
+     */
+    void add(const Mat4& mat, const std::string& text);
+
+    /*! @brief Draws all queued text.
+     */
+    void draw() const;
+
+private:
+    const Spritesheet* font;
+    std::vector<Geometry::Vertex> vertices;
+
+#ifndef INU_MESH_FALLBACK
+    class Shared
+    {
+    public:
+        Shared();
+        ~Shared();
+
+        GLuint vertexBuffer;
+        GLuint vertexArray;
+        std::size_t capacity;
+    };
+
+    std::shared_ptr<Shared> share;
+#endif // INU_MESH_FALLBACK
+};
+
+/*! @brief Cache of formatted numbers.
+ *
+ *  Right-aligns integers to a fixed width, formatting each value only once.
+ */
+class NumberText
+{
+public:
+    /*! @brief Primary constructor.
+     *
+     *  @param w Minimum width, padded with spaces.
+     */
+    NumberText(int w);
+
+    /*! @brief Gets the formatted text for a value.
+     *
+     *  @param val Value to format.
+     *
+     *  @return Formatted text.
+     */
+    const std::string& operator()(int val);
+
+private:
+    int width;
+    std::map<int, std::string> cache;
+};
+
+} // namespace Inugami
+
+#endif // INUGAMI_TEXTBATCH_H
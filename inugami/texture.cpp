@@ -60,6 +60,11 @@ public:
     std::string err;
 };
 
+// Mirrors the texture bindings of the context, so that binding an already
+// bound texture costs nothing.
+static GLuint boundTextures[32] = {};
+static unsigned int activeSlot = 0;
+
 Texture::Shared::Shared()
     : id(0)
 {
@@ -68,6 +73,12 @@ Texture::Shared::Shared()
 
 Texture::Shared::~Shared()
 {
+    // Deleting a texture unbinds it from every slot
+    for (GLuint& bound : boundTextures)
+    {
+        if (bound == id) bound = 0;
+    }
+
     glDeleteTextures(1, &id);
 }
 
@@ -82,13 +93,23 @@ Texture::Texture(const Image& img, bool smooth, bool clamp)
 void Texture::bind(unsigned int slot) const
 {
     if (slot > 31) throw TextureException("Invalid texture slot!");
-    glActiveTexture(GL_TEXTURE0+slot);
+
+    if (boundTextures[slot] == share->id) return;
+
+    if (activeSlot != slot)
+    {
+        glActiveTexture(GL_TEXTURE0+slot);
+        activeSlot = slot;
+    }
+
     glBindTexture(GL_TEXTURE_2D, share->id);
+    boundTextures[slot] = share->id;
 }
 
 void Texture::upload(const Image& img, bool smooth, bool clamp)
 {
     glBindTexture(GL_TEXTURE_2D, share->id);
+    boundTextures[activeSlot] = share->id;
 
     GLuint filter = (smooth)? GL_LINEAR : GL_NEAREST;
     GLuint wrap   = (clamp )? GL_CLAMP  : GL_REPEAT;
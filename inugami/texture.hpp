@@ -62,6 +62,11 @@ public:
     Texture(const Image& img, bool smooth=false, bool clamp=false);
 
     /*! @brief Binds the texture.
+     *
+     *  Does nothing if the texture is already bound to the slot.
+     *
+     *  @note The binding cache assumes that all textures are bound through
+     *  this function and that there is only one context.
      *
      *  @param slot Texture slot to bind.
      */
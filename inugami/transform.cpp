@@ -27,54 +27,165 @@
 
 #include "transform.hpp"
 
-#include <glm/glm.hpp>
-#include <glm/gtc/matrix_transform.hpp>
+#include "math.hpp"
+
+#include <algorithm>
+#include <cmath>
 
 namespace Inugami {
 
-Transform::Transform()
-    : stack{Mat4(1.f)}
+TransformException::TransformException(const std::string& what)
+    : err("Transform Exception: "+what)
 {}
 
+const char* TransformException::what() const noexcept
+{
+    return err.c_str();
+}
+
+Transform::Transform()
+    : top(0)
+{
+    reset();
+}
+
+Transform::Transform(const Transform& in)
+    : top(in.top)
+{
+    std::copy(in.stack, in.stack+top+1, stack);
+}
+
+Transform& Transform::operator=(const Transform& in)
+{
+    top = in.top;
+    std::copy(in.stack, in.stack+top+1, stack);
+    return *this;
+}
+
 Transform::operator Mat4() const
 {
-    return stack.back();
+    const Affine& m = stack[top];
+
+    Mat4 rval (1.f);
+
+    for (int c=0; c<4; ++c)
+    {
+        for (int r=0; r<3; ++r)
+        {
+            rval[c][r] = m.rows[r][c];
+        }
+    }
+
+    return rval;
 }
 
 Transform& Transform::translate(const Vec3& pos)
 {
-    stack.back() = ::glm::translate(stack.back(), pos);
+    Affine& m = stack[top];
+
+    for (int r=0; r<3; ++r)
+    {
+        float* row = m.rows[r];
+        row[3] += row[0]*pos.x + row[1]*pos.y + row[2]*pos.z;
+    }
+
     return *this;
 }
 
 Transform& Transform::scale(const Vec3& vec)
 {
-    stack.back() = ::glm::scale(stack.back(), vec);
+    Affine& m = stack[top];
+
+    const float v[4] = {vec.x, vec.y, vec.z, 1.f};
+
+    for (int r=0; r<3; ++r)
+    {
+        for (int c=0; c<4; ++c)
+        {
+            m.rows[r][c] *= v[c];
+        }
+    }
+
     return *this;
 }
 
 Transform& Transform::rotate(float deg, const Vec3& axis)
 {
-    stack.back() = ::glm::rotate(stack.back(), deg, axis);
+    Affine& m = stack[top];
+
+    const float rad = toRadians(deg);
+    const float cs = std::cos(rad);
+    const float sn = std::sin(rad);
+
+    // Rotation about Z only mixes the first two columns
+    if (axis.x == 0.f && axis.y == 0.f && axis.z > 0.f)
+    {
+        for (int r=0; r<3; ++r)
+        {
+            float* row = m.rows[r];
+            const float x = row[0];
+            const float y = row[1];
+            row[0] = x*cs + y*sn;
+            row[1] = y*cs - x*sn;
+        }
+
+        return *this;
+    }
+
+    const float len = std::sqrt(axis.x*axis.x + axis.y*axis.y + axis.z*axis.z);
+    const float x = axis.x/len;
+    const float y = axis.y/len;
+    const float z = axis.z/len;
+    const float t = 1.f-cs;
+
+    // rot[c][r], column-major like glm
+    const float rot[3][3] = {
+          {t*x*x + cs  , t*x*y + sn*z, t*x*z - sn*y}
+        , {t*x*y - sn*z, t*y*y + cs  , t*y*z + sn*x}
+        , {t*x*z + sn*y, t*y*z - sn*x, t*z*z + cs  }
+    };
+
+    for (int r=0; r<3; ++r)
+    {
+        float* row = m.rows[r];
+        const float old[3] = {row[0], row[1], row[2]};
+
+        for (int c=0; c<3; ++c)
+        {
+            row[c] = old[0]*rot[c][0] + old[1]*rot[c][1] + old[2]*rot[c][2];
+        }
+    }
+
     return *this;
 }
 
 Transform& Transform::push()
 {
-    stack.push_back(stack.back());
+    if (top+1 >= CAPACITY) throw TransformException("Stack overflow!");
+    stack[top+1] = stack[top];
+    ++top;
     return *this;
 }
 
 Transform& Transform::pop()
 {
-    stack.pop_back();
+    if (top == 0) throw TransformException("Stack underflow!");
+    --top;
     return *this;
 }
 
 Transform& Transform::reset()
 {
-    stack.clear();
-    stack.emplace_back(1.f);
+    top = 0;
+
+    for (int r=0; r<3; ++r)
+    {
+        for (int c=0; c<4; ++c)
+        {
+            stack[0].rows[r][c] = (r == c)? 1.f : 0.f;
+        }
+    }
+
     return *this;
 }
 
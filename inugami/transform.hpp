@@ -28,21 +28,50 @@
 #ifndef INUGAMI_TRANSFORM_H
 #define INUGAMI_TRANSFORM_H
 
+#include "exception.hpp"
 #include "mathtypes.hpp"
 
-#include <vector>
+#include <string>
 
 namespace Inugami {
 
+class TransformException
+    : public Exception
+{
+public:
+    TransformException(const std::string& what);
+    virtual const char* what() const noexcept override;
+    std::string err;
+};
+
+/*! @brief Affine matrix stack.
+ *
+ *  Matrices are stored as the top three rows of a 4x4 affine matrix, and the
+ *  stack lives inside the object, so building transforms never allocates.
+ *  Translation, scaling, and rotation are applied directly to the stored rows
+ *  instead of through full 4x4 multiplies.
+ */
 class Transform
 {
-    typedef std::vector<Mat4> Stack;
 public:
+    static constexpr int CAPACITY = 16; //!< Maximum stack depth.
 
     /*! @brief Default constructor.
      */
     Transform();
 
+    /*! @brief Copy constructor.
+     *
+     *  Only the live part of the stack is copied.
+     */
+    Transform(const Transform& in);
+
+    /*! @brief Copy assignment.
+     *
+     *  Only the live part of the stack is copied.
+     */
+    Transform& operator=(const Transform& in);
+
     /*! @brief Mat4 cast.
      */
     operator Mat4() const;
@@ -69,12 +98,16 @@ public:
     /*! @brief Push the stack.
      *
      *  Pushes a copy of the current matrix on the stack.
+     *
+     *  @throws TransformException if the stack is already CAPACITY deep.
      */
     Transform& push();
 
     /*! @brief Pop the stack.
      *
      *  Pops the current matrix off the stack.
+     *
+     *  @throws TransformException if only one matrix is left.
      */
     Transform& pop();
 
@@ -85,7 +118,13 @@ public:
     Transform& reset();
 
 private:
-    Stack stack;
+    struct alignas(16) Affine
+    {
+        float rows[3][4];
+    };
+
+    Affine stack[CAPACITY];
+    int top;
 };
 
 } // namespace Inugami
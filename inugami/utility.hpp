@@ -32,7 +32,9 @@
 #include "detail/containerutils.hpp"
 #include "detail/constattr.hpp"
 #include "detail/constmap.hpp"
+#include "detail/mpscring.hpp"
 #include "detail/range.hpp"
 #include "detail/streamutils.hpp"
+#include "detail/triplebuffer.hpp"
 
 #endif // UTILITY_HPP_INCLUDED
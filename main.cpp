@@ -30,28 +30,101 @@
 
 #include "inugami/exception.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
 #include <fstream>
 #include <iostream>
 #include <exception>
 #include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <string>
 
 using namespace Inugami;
 
 void dumpProfiles();
+void dumpFrameTimes(const std::vector<double>& times);
+void dumpTrace(const std::string& filename);
+void dumpSlowFrame(const Core::Overrun& overrun);
 
 int main(int argc, char* argv[])
 {
     profiler = new Profiler();
-    ScopedProfile prof(profiler, "Main");
+    metrics = new Metrics();
+    static const Profiler::Zone zone ("Main");
+    ScopedProfile prof(profiler, zone);
 
     std::ofstream logfile("log.txt");
     logger = new Logger<5>(logfile);
 
+    //Lines are written by a background thread until main() returns, and
+    //INU_LOG() lines go to log.bin for arena/logdecode
+    std::ofstream binlog("log.bin", std::ios::binary);
+    AsyncLog<Logger<5>> asyncLog (logger, 4096, LogOverflow::DROP, &binlog);
+
+    //--headless N renders N frames offscreen, --dump PREFIX saves them
+    unsigned benchFrames = 0;
+    std::string dumpPrefix;
+
+    //--trace N keeps the last N profiles of each thread for trace.json
+    unsigned traceEvents = 0;
+
+    //--metrics FILE rewrites FILE every second, --metrics-socket PATH serves
+    std::string metricsFile;
+    std::string metricsSocket;
+
+    //--watchdog writes calls that overrun their budget to slowframes.txt
+    bool watchdog = false;
+
+    //--counters adds hardware counters to profile.txt, where available
+    bool counters = false;
+
     logger->log<1>("Args:");
-    while (*argv)
+    for (int i=0; i<argc; ++i)
     {
-        logger->log<1>(*argv);
-        ++argv;
+        logger->log<1>(argv[i]);
+
+        std::string arg = argv[i];
+        try
+        {
+            if (i+1 < argc && arg == "--headless") benchFrames = std::stoul(argv[i+1]);
+            if (i+1 < argc && arg == "--trace") traceEvents = std::stoul(argv[i+1]);
+        }
+        catch (const std::logic_error&)
+        {
+            std::string error = "Bad number for " + arg + ": " + argv[i+1];
+            std::cout << error << std::endl;
+            std::ofstream("error.txt") << error;
+            return -1;
+        }
+        if (i+1 < argc && arg == "--dump") dumpPrefix = argv[i+1];
+        if (i+1 < argc && arg == "--metrics") metricsFile = argv[i+1];
+        if (i+1 < argc && arg == "--metrics-socket") metricsSocket = argv[i+1];
+        if (arg == "--watchdog") watchdog = true;
+        if (arg == "--counters") counters = true;
+    }
+
+    if (traceEvents > 0)
+    {
+        profiler->setTracing(traceEvents);
+#ifdef SIGUSR1
+        std::signal(SIGUSR1, [](int){ profiler->requestTrace(); });
+#endif // SIGUSR1
+    }
+
+    if (counters)
+    {
+        if (Profiler::countersAvailable()) profiler->setCounters(true);
+        else logger->log<1>("Hardware counters are unavailable.");
+    }
+
+    if (watchdog)
+    {
+        //Slow frames are dumped from the recent trace, even without --trace
+        if (traceEvents == 0) profiler->setTracing(1024);
+        logger->keepRecent(20);
     }
 
     CustomCore::RenderParams renparams;
@@ -60,13 +133,79 @@ int main(int argc, char* argv[])
     renparams.fullscreen = false;
     renparams.vsync = false;
     renparams.fsaaSamples = 0;
+    renparams.headless = (benchFrames > 0);
 
     try
     {
+        logger->log<5>("Loading rules...");
+        Rules rules = Rules::fromFile("rules.txt");
+
         logger->log<5>("Creating Core...");
-        CustomCore base(renparams);
+        CustomCore base(renparams, rules);
+
+        if (renparams.headless)
+        {
+            base.captureFrames(true, dumpPrefix);
+            base.addCallback([&]
+            {
+                if (base.getFrameTimes().size() >= benchFrames) base.running = false;
+            }, 60.0);
+        }
+
+        if (traceEvents > 0)
+        {
+            //Traces requested by SIGUSR1 are written between frames
+            base.addCallback([]
+            {
+                static int count = 0;
+                if (profiler->takeTraceRequest())
+                {
+                    dumpTrace("trace-" + std::to_string(count++) + ".json");
+                }
+            }, 1.0);
+        }
+
+        if (!metricsFile.empty())
+        {
+            //A full disk shouldn't end the game
+            base.addCallback([&]
+            {
+                try
+                {
+                    metrics->writeFile(metricsFile);
+                }
+                catch (const MetricsException& e)
+                {
+                    logger->log<1>(e.what());
+                }
+            }, 1.0);
+        }
+
+        if (!metricsSocket.empty())
+        {
+            try
+            {
+                metrics->serve(metricsSocket);
+            }
+            catch (const MetricsException& e)
+            {
+                logger->log<1>(e.what());
+            }
+        }
+
+        static auto& overruns = metrics->counter("superball_overruns_total", "Calls that took longer than their frequency allows.");
+        base.setOverrunHandler([watchdog](const Core::Overrun& overrun)
+        {
+            overruns.add(1);
+            if (watchdog) dumpSlowFrame(overrun);
+        });
+
         logger->log<5>("Go!");
         base.go();
+
+        metrics->stop();
+
+        if (renparams.headless) dumpFrameTimes(base.getFrameTimes());
     }
     catch (const std::exception& e)
     {
@@ -82,6 +221,7 @@ int main(int argc, char* argv[])
     }
 
     dumpProfiles();
+    if (traceEvents > 0) dumpTrace("trace.json");
 
     return 0;
 }
@@ -100,7 +240,29 @@ void dumpProfiles()
         pfile << indent << "Min: " << in->min     << "\n";
         pfile << indent << "Max: " << in->max     << "\n";
         pfile << indent << "Avg: " << in->average << "\n";
-        pfile << indent << "Num: " << in->samples << "\n\n";
+        pfile << indent << "Num: " << in->samples << "\n";
+        if (in->hasHistogram())
+        {
+            pfile << indent << "P50: "   << in->percentile(50.0) << "\n";
+            pfile << indent << "P99: "   << in->percentile(99.0) << "\n";
+            pfile << indent << "P99.9: " << in->percentile(99.9) << "\n";
+        }
+        if (Profiler::tracksAllocations())
+        {
+            pfile << indent << "Allocs: " << in->allocations << " (" << in->allocatedBytes << " bytes)\n";
+            pfile << indent << "Frees: "  << in->deallocations << "\n";
+            if (in->samples > 0)
+            {
+                pfile << indent << "Allocs/Call: " << double(in->allocations)/in->samples << "\n";
+            }
+        }
+        if (in->hasCounters())
+        {
+            pfile << indent << "IPC: " << in->getIPC() << "\n";
+            pfile << indent << "Cache Misses: " << in->getCacheMissRate()*100.0 << "%\n";
+            pfile << indent << "Branch Misses: " << in->getBranchMissRate()*100.0 << "%\n";
+        }
+        pfile << "\n";
         for (auto& p : in->getChildren())
         {
             pfile << indent << p.first << ":\n";
@@ -113,4 +275,77 @@ void dumpProfiles()
         pfile << p.first << ":\n";
         dumProf(p.second, "\t");
     }
+
+    for (auto& t : profiler->getThreads())
+    {
+        pfile << "\n" << t.first << ":\n";
+        for (auto& p : t.second->getChildren())
+        {
+            pfile << "\t" << p.first << ":\n";
+            dumProf(p.second, "\t\t");
+        }
+    }
+}
+
+void dumpFrameTimes(const std::vector<double>& times)
+{
+    std::ofstream tfile("frametimes.txt");
+
+    for (double t : times) tfile << t << "\n";
+
+    if (times.empty()) return;
+
+    std::vector<double> sorted = times;
+    std::sort(begin(sorted), end(sorted));
+
+    double sum = 0.0;
+    for (double t : sorted) sum += t;
+
+    std::cout << "Frames: " << sorted.size() << "\n";
+    std::cout << "Avg: " << sum/sorted.size() << "\n";
+    std::cout << "Median: " << sorted[sorted.size()/2] << "\n";
+    std::cout << "Max: " << sorted.back() << std::endl;
+}
+
+void dumpTrace(const std::string& filename)
+{
+    std::ofstream tfile(filename);
+    profiler->writeTrace(tfile);
+}
+
+void dumpSlowFrame(const Core::Overrun& overrun)
+{
+    using namespace std::chrono;
+
+    //At most one dump a second, so dumping can't cause the next overrun
+    static std::mutex mutex;
+    static steady_clock::time_point last;
+
+    std::lock_guard<std::mutex> lock (mutex);
+
+    if (last != steady_clock::time_point() && overrun.end - last < seconds(1)) return;
+    last = overrun.end;
+
+    //Rotated at 1 MiB, keeping two old files
+    const char* const files[] = {"slowframes.txt", "slowframes.1.txt", "slowframes.2.txt"};
+    if (std::ifstream(files[0], std::ios::ate).tellg() > (1<<20))
+    {
+        std::remove(files[2]);
+        std::rename(files[1], files[2]);
+        std::rename(files[0], files[1]);
+    }
+
+    std::ofstream sfile(files[0], std::ios::app);
+
+    if (overrun.callback < 0) sfile << "Update";
+    else sfile << "Callback " << overrun.callback;
+    sfile << " took " << overrun.elapsed*1e3 << " ms of " << overrun.budget*1e3 << " ms\n";
+
+    sfile << "Profiles:\n";
+    profiler->writeWindow(sfile, overrun.start, overrun.end);
+
+    sfile << "Log:\n";
+    for (auto& line : logger->getRecent()) sfile << line << "\n";
+
+    sfile << "\n";
 }
@@ -1,4 +1,5 @@
 #include "meta.hpp"
 
 Inugami::Logger<5> *logger;
+Inugami::Metrics *metrics;
 Inugami::Profiler *profiler;
@@ -2,9 +2,11 @@
 #define LOG_H
 
 #include "inugami/logger.hpp"
+#include "inugami/metrics.hpp"
 #include "inugami/profiler.hpp"
 
 extern Inugami::Logger<5> *logger;
+extern Inugami::Metrics *metrics;
 extern Inugami::Profiler *profiler;
 
 #endif // LOG_H
@@ -0,0 +1,380 @@
+/*******************************************************************************
+ * Inugami - An OpenGL framework designed for rapid game development
+ * Version: 0.2.0
+ * https://github.com/DBRalir/Inugami
+ *
+ * Copyright (c) 2012 Jeramy Harrison <dbralir@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#include "replay.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+namespace Replay {
+
+static const char MAGIC[4] = {'I', 'S', 'B', 'R'};
+static const std::uint16_t VERSION = 2;
+
+Error::Error(const std::string& what)
+    : std::runtime_error("Replay: "+what)
+{}
+
+Header::Header()
+    : rules()
+    , seed(0)
+{}
+
+Header::Header(const Rules& rules, std::uint32_t seed)
+    : rules(rules)
+    , seed(seed)
+{}
+
+bool Event::isMove() const
+{
+    return (op == SWAP || op == SCORE);
+}
+
+/* Writer --                          --                            -- Writer */
+
+Writer::Writer(const std::string& filename, const Header& h)
+    : file(filename, std::ios::binary)
+{
+    if (!file) throw Error("Can't open "+filename+"!");
+
+    file.write(MAGIC, 4);
+    put16(VERSION);
+    put16(h.rules.numColors);
+    put16(h.rules.swapSpawn);
+    put16(h.rules.scoreSpawn);
+    put16(h.rules.width);
+    put16(h.rules.height);
+    put16(h.rules.minScore);
+    put16(h.rules.zoneRows);
+    put16(h.rules.zoneCols);
+    put32(h.seed);
+}
+
+void Writer::swap(int a, int b)
+{
+    put8(Event::SWAP<<6);
+    put16(a);
+    put16(b);
+}
+
+void Writer::score(int a)
+{
+    put8(Event::SCORE<<6);
+    put16(a);
+}
+
+void Writer::spawn(int cell, int color)
+{
+    put8(Event::SPAWN<<6 | (color & 0x3F));
+    put16(cell);
+}
+
+void Writer::reset()
+{
+    put8(Event::RESET<<6);
+}
+
+void Writer::flush()
+{
+    file.flush();
+}
+
+void Writer::put8(std::uint8_t v)
+{
+    file.put(char(v));
+}
+
+void Writer::put16(std::uint16_t v)
+{
+    put8(v & 0xFF);
+    put8(v >> 8);
+}
+
+void Writer::put32(std::uint32_t v)
+{
+    put16(v & 0xFFFF);
+    put16(v >> 16);
+}
+
+/* Player --                          --                            -- Player */
+
+Player::Player(const std::string& filename, int iv)
+    : head()
+    , events()
+    , moves()
+    , snapshots()
+    , interval(std::max(iv, 1))
+
+    , cells()
+    , points(0)
+    , games(0)
+    , cursor(0)
+    , pos(0)
+{
+    std::ifstream file(filename, std::ios::binary);
+    if (!file) throw Error("Can't open "+filename+"!");
+
+    const std::vector<char> data(
+          (std::istreambuf_iterator<char>(file))
+        , std::istreambuf_iterator<char>()
+    );
+
+    std::size_t at = 0;
+
+    auto get8 = [&]() -> std::uint8_t
+    {
+        if (at >= data.size()) throw Error("Unexpected end of file!");
+        return std::uint8_t(data[at++]);
+    };
+
+    auto get16 = [&]() -> std::uint16_t
+    {
+        std::uint16_t lo = get8();
+        return lo | std::uint16_t(get8())<<8;
+    };
+
+    auto get32 = [&]() -> std::uint32_t
+    {
+        std::uint32_t lo = get16();
+        return lo | std::uint32_t(get16())<<16;
+    };
+
+    if (data.size() < 4 || !std::equal(MAGIC, MAGIC+4, data.begin()))
+    {
+        throw Error(filename+" is not a replay!");
+    }
+    at = 4;
+
+    const std::uint16_t version = get16();
+    if (version < 1 || version > VERSION) throw Error("Unsupported version!");
+
+    head.rules.numColors  = get16();
+    head.rules.swapSpawn  = get16();
+    head.rules.scoreSpawn = get16();
+    head.rules.width      = get16();
+    head.rules.height     = get16();
+    head.rules.minScore   = get16();
+    if (version >= 2)
+    {
+        head.rules.zoneRows = get16();
+        head.rules.zoneCols = get16();
+    }
+    head.seed             = get32();
+
+    head.rules.validate();
+
+    const int numCells = head.rules.width*head.rules.height;
+
+    while (at < data.size())
+    {
+        const std::uint8_t op = get8();
+
+        Event e;
+        e.op = Event::Op(op>>6);
+        e.a = 0;
+        e.b = 0;
+
+        switch (e.op)
+        {
+            case Event::SWAP:
+            {
+                e.a = get16();
+                e.b = get16();
+                if (e.b >= numCells) throw Error("Cell out of range!");
+            break;}
+
+            case Event::SCORE:
+            {
+                e.a = get16();
+            break;}
+
+            case Event::SPAWN:
+            {
+                e.a = get16();
+                e.b = op & 0x3F;
+            break;}
+
+            case Event::RESET:
+            default:
+            {
+            break;}
+        }
+
+        if (e.op != Event::RESET && e.a >= numCells) throw Error("Cell out of range!");
+
+        if (e.isMove()) moves.push_back(events.size());
+        events.push_back(e);
+    }
+
+    cells.assign(numCells, 0);
+    settle();
+
+    do
+    {
+        if (pos % interval == 0) snapshots.push_back({cells, points, games, cursor});
+    } while (step());
+
+    seek(0);
+}
+
+const Header& Player::header() const
+{
+    return head;
+}
+
+int Player::numMoves() const
+{
+    return moves.size();
+}
+
+int Player::position() const
+{
+    return pos;
+}
+
+void Player::seek(int move)
+{
+    move = std::max(0, std::min(move, numMoves()));
+
+    const Snapshot& snap = snapshots[move/interval];
+
+    cells  = snap.board;
+    points = snap.score;
+    games  = snap.game;
+    cursor = snap.event;
+    pos    = (move/interval)*interval;
+
+    while (pos < move) step();
+}
+
+bool Player::step()
+{
+    if (pos >= numMoves()) return false;
+
+    apply(events[cursor++]);
+    settle();
+    ++pos;
+
+    return true;
+}
+
+const Event& Player::nextMove() const
+{
+    if (pos >= numMoves()) throw Error("No more moves!");
+    return events[moves[pos]];
+}
+
+const Board& Player::board() const
+{
+    return cells;
+}
+
+int Player::score() const
+{
+    return points;
+}
+
+int Player::game() const
+{
+    return games;
+}
+
+void Player::apply(const Event& e)
+{
+    switch (e.op)
+    {
+        case Event::SWAP:
+        {
+            std::swap(cells[e.a], cells[e.b]);
+        break;}
+
+        case Event::SCORE:
+        {
+            const int w = head.rules.width;
+            const int h = head.rules.height;
+            const std::uint8_t k = cells[e.a];
+
+            if (k == 0) break;
+
+            std::vector<int> stack{e.a};
+            cells[e.a] = 0;
+            int size = 0;
+
+            while (!stack.empty())
+            {
+                int i = stack.back();
+                stack.pop_back();
+                ++size;
+
+                const int r = i/w;
+                const int c = i%w;
+
+                auto visit = [&](int n)
+                {
+                    if (cells[n] != k) return;
+                    cells[n] = 0;
+                    stack.push_back(n);
+                };
+
+                if (r>0)   visit(i-w);
+                if (r<h-1) visit(i+w);
+                if (c>0)   visit(i-1);
+                if (c<w-1) visit(i+1);
+            }
+
+            points += (k+1)*size;
+        break;}
+
+        case Event::SPAWN:
+        {
+            cells[e.a] = e.b;
+        break;}
+
+        case Event::RESET:
+        {
+            std::fill(cells.begin(), cells.end(), 0);
+            points = 0;
+            ++games;
+        break;}
+
+        default:
+        {
+            throw Error("Unknown event!");
+        }
+    }
+}
+
+void Player::settle()
+{
+    while (cursor < events.size() && !events[cursor].isMove())
+    {
+        apply(events[cursor++]);
+    }
+}
+
+} // namespace Replay
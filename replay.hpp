@@ -0,0 +1,150 @@
+/*******************************************************************************
+ * Inugami - An OpenGL framework designed for rapid game development
+ * Version: 0.2.0
+ * https://github.com/DBRalir/Inugami
+ *
+ * Copyright (c) 2012 Jeramy Harrison <dbralir@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#ifndef REPLAY_HPP
+#define REPLAY_HPP
+
+#include "rules.hpp"
+
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Binary game recordings.
+//
+// A replay is a header (rules and seed) followed by a stream of packed events.
+// Every piece the game spawns is recorded, so playback needs neither the RNG
+// nor a window.
+namespace Replay {
+
+class Error
+    : public std::runtime_error
+{
+public:
+    Error(const std::string& what);
+};
+
+struct Header
+{
+    Rules rules;
+    std::uint32_t seed;
+
+    Header();
+    Header(const Rules& rules, std::uint32_t seed);
+};
+
+class Event
+{
+public:
+    enum Op : std::uint8_t
+    {
+          SWAP
+        , SCORE
+        , SPAWN
+        , RESET
+    };
+
+    Op op;
+    std::uint16_t a;    // SWAP, SCORE and SPAWN: cell index
+    std::uint16_t b;    // SWAP: second cell index, SPAWN: color
+
+    bool isMove() const;
+};
+
+using Board = std::vector<std::uint8_t>;
+
+class Writer
+{
+public:
+    Writer(const std::string& filename, const Header& h);
+
+    void swap(int a, int b);
+    void score(int a);
+    void spawn(int cell, int color);
+    void reset();
+
+    void flush();
+
+private:
+    std::ofstream file;
+
+    void put8(std::uint8_t v);
+    void put16(std::uint16_t v);
+    void put32(std::uint32_t v);
+};
+
+// Plays a recording back. A snapshot of the board is kept every few moves so
+// that seek() only has to replay a short run of events.
+class Player
+{
+public:
+    Player(const std::string& filename, int interval = 64);
+
+    const Header& header() const;
+
+    int numMoves() const;
+    int position() const;
+
+    void seek(int move);
+    bool step();
+
+    const Event& nextMove() const;
+
+    const Board& board() const;
+    int score() const;
+    int game() const;
+
+private:
+    struct Snapshot
+    {
+        Board board;
+        int score;
+        int game;
+        std::size_t event;
+    };
+
+    Header head;
+    std::vector<Event> events;
+    std::vector<std::size_t> moves;
+    std::vector<Snapshot> snapshots;
+    int interval;
+
+    Board cells;
+    int points;
+    int games;
+    std::size_t cursor;
+    int pos;
+
+    void apply(const Event& e);
+    void settle();
+};
+
+} // namespace Replay
+
+#endif // REPLAY_HPP
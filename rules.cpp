@@ -0,0 +1,122 @@
+/*******************************************************************************
+ * Inugami - An OpenGL framework designed for rapid game development
+ * Version: 0.2.0
+ * https://github.com/DBRalir/Inugami
+ *
+ * Copyright (c) 2012 Jeramy Harrison <dbralir@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#include "rules.hpp"
+
+#include <fstream>
+#include <map>
+#include <sstream>
+
+RulesError::RulesError(const std::string& what)
+    : std::runtime_error("Rules: "+what)
+{}
+
+Rules Rules::fromFile(const std::string& filename) //static
+{
+    Rules rval;
+
+    std::ifstream file(filename);
+    if (!file) return rval;
+
+    const std::map<std::string, int Rules::*> keys = {
+          {"width"     , &Rules::width     }
+        , {"height"    , &Rules::height    }
+        , {"colors"    , &Rules::numColors }
+        , {"swapSpawn" , &Rules::swapSpawn }
+        , {"scoreSpawn", &Rules::scoreSpawn}
+        , {"minScore"  , &Rules::minScore  }
+        , {"zoneRows"  , &Rules::zoneRows  }
+        , {"zoneCols"  , &Rules::zoneCols  }
+    };
+
+    std::string line;
+    int lineNum = 0;
+
+    while (getline(file, line))
+    {
+        ++lineNum;
+
+        std::stringstream ss(line.substr(0, line.find('#')));
+
+        std::string key;
+        if (!(ss >> key)) continue;
+
+        auto iter = keys.find(key);
+        if (iter == keys.end())
+        {
+            throw RulesError(filename+":"+std::to_string(lineNum)+": Unknown key \""+key+"\"!");
+        }
+
+        if (!(ss >> (rval.*(iter->second))))
+        {
+            throw RulesError(filename+":"+std::to_string(lineNum)+": Expected a number!");
+        }
+
+        if (!(ss >> std::ws).eof())
+        {
+            throw RulesError(filename+":"+std::to_string(lineNum)+": Unexpected text after value!");
+        }
+    }
+
+    rval.validate();
+
+    return rval;
+}
+
+Rules::Rules()
+    : numColors(5)
+    , swapSpawn(5)
+    , scoreSpawn(3)
+    , width(10)
+    , height(8)
+    , minScore(5)
+    , zoneRows(2)
+    , zoneCols(2)
+{}
+
+void Rules::validate() const
+{
+    auto check = [](bool ok, const char* what)
+    {
+        if (!ok) throw RulesError(what);
+    };
+
+    check(width  >= 2 && width  <= MAX_SIZE, "Width out of range!");
+    check(height >= 2 && height <= MAX_SIZE, "Height out of range!");
+    check(numColors >= 1 && numColors <= MAX_COLORS, "Color count out of range!");
+    check(swapSpawn  >= 0 && swapSpawn  < width*height, "Swap spawn count out of range!");
+    check(scoreSpawn >= 0 && scoreSpawn < width*height, "Score spawn count out of range!");
+    check(minScore >= 1 && minScore <= width*height, "Minimum score out of range!");
+    check(zoneRows >= 0 && zoneRows*2 < height, "Score zone rows out of range!");
+    check(zoneCols >= 1 && zoneCols*2 <= width, "Score zone columns out of range!");
+}
+
+bool Rules::isScoreTile(int r, int c) const
+{
+    return (r >= zoneRows && r < height-zoneRows)
+        && (c < zoneCols || c >= width-zoneCols);
+}
@@ -0,0 +1,78 @@
+/*******************************************************************************
+ * Inugami - An OpenGL framework designed for rapid game development
+ * Version: 0.2.0
+ * https://github.com/DBRalir/Inugami
+ *
+ * Copyright (c) 2012 Jeramy Harrison <dbralir@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#ifndef RULES_HPP
+#define RULES_HPP
+
+#include <stdexcept>
+#include <string>
+
+// Game rules shared by the game, the arena and the AI.
+//
+// Rules files are plain text, one "key value" pair per line. Lines starting
+// with '#' are comments. Keys that are left out keep their default value.
+//
+//     width      10
+//     height     8
+//     colors     5
+//     swapSpawn  5
+//     scoreSpawn 3
+//     minScore   5
+//     zoneRows   2     # rows above and below the score zone
+//     zoneCols   2     # score zone columns on each side of the board
+class RulesError
+    : public std::runtime_error
+{
+public:
+    RulesError(const std::string& what);
+};
+
+class Rules
+{
+public:
+    static constexpr int MAX_SIZE   = 256;
+    static constexpr int MAX_COLORS = 7;
+
+    static Rules fromFile(const std::string& filename);
+
+    Rules();
+
+    void validate() const;
+
+    bool isScoreTile(int r, int c) const;
+
+    int numColors;
+    int swapSpawn;
+    int scoreSpawn;
+    int width;
+    int height;
+    int minScore;
+    int zoneRows;
+    int zoneCols;
+};
+
+#endif // RULES_HPP
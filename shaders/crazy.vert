@@ -1,16 +1,65 @@
-
 #version 330
 layout (location = 0) in vec3 VertexPosition;
 layout (location = 1) in vec3 VertexNormal;
 layout (location = 2) in vec2 VertexTexCoord;
+layout (location = 3) in vec3 InstanceOffset;
+layout (location = 4) in vec3 InstanceScale;
+layout (location = 5) in vec4 InstanceColor;
+layout (location = 6) in vec4 InstanceAnim;
 uniform mat4 MVP;
+uniform mat4 projectionMatrix;
+uniform float Time;
+uniform vec2 Shake;
 out vec3 Position;
 out vec3 Normal;
 out vec2 TexCoord;
+out vec4 Tint;
+
+// InstanceAnim is (kind, start time, x, y), kinds match CustomCore
+const float ANIM_SPAWN = 1.0;
+const float ANIM_SWAP  = 2.0;
+const float ANIM_FLASH = 3.0;
+const float ANIM_SPIN  = 4.0;
+
+float hash(float n)
+{
+    return fract(sin(n)*43758.5453);
+}
+
 void main()
 {
+    vec3 scale = InstanceScale;
+    vec3 offset = InstanceOffset;
+    vec4 color = InstanceColor;
+    float t = Time-InstanceAnim.y;
+
+    if (InstanceAnim.x == ANIM_SPAWN)
+    {
+        scale.xy *= min(1.0, 0.05*pow(1.25, 60.0*t));
+    }
+    else if (InstanceAnim.x == ANIM_SWAP || InstanceAnim.x == ANIM_SPIN)
+    {
+        // Orbit the center at 600 degrees per second, pulling in mid-swap.
+        // A swap holds at 180 degrees until it's cleared, a spin loops.
+        float deg = (InstanceAnim.x == ANIM_SPIN)? mod(600.0*t, 180.0) : min(600.0*t, 180.0);
+        float a = radians(deg);
+        vec2 d = (offset.xy-InstanceAnim.zw)*(2.0-sin(a))/2.0;
+        offset.xy = InstanceAnim.zw + vec2(d.x*cos(a)-d.y*sin(a), d.x*sin(a)+d.y*cos(a));
+    }
+    else if (InstanceAnim.x == ANIM_FLASH)
+    {
+        if (mod(floor(60.0*t), 2.0) == 1.0) color = vec4(1.0);
+    }
+
     TexCoord = VertexTexCoord;
     Normal = normalize(VertexNormal);
-    Position = VertexPosition;
-    gl_Position = MVP * vec4(VertexPosition,1.0);
+    Position = VertexPosition*scale+offset;
+    Tint = color;
+    gl_Position = MVP * vec4(Position,1.0);
+
+    // Screen shake picks a new offset every 60th of a second and decays
+    float tick = floor(60.0*Time);
+    float amp = Shake.x*pow(0.9, 60.0*(Time-Shake.y));
+    vec2 shake = amp*(vec2(hash(tick), hash(tick+0.5))*2.0-1.0);
+    gl_Position += projectionMatrix*vec4(shake, 0.0, 0.0);
 }